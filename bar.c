@@ -21,6 +21,7 @@ static void display_string(char *s, int x, int y);
 static void display_char(char c, int *x, int *y);
 static int change_color(char *c);
 static void clear(Rectangle *area);
+static bool suspended();
 
 static xcb_window_t     window;
 static xcb_pixmap_t     pixmap;
@@ -298,10 +299,18 @@ bar_hide()
     xcb_unmap_window(g_xcb, window);
 }
 
+/* nobody sees the bar under a fullscreen client, it is redrawn when
+ * the fullscreen ends, see monitor_render */
+bool
+suspended()
+{
+    return monitor && monitor->fullscreens;
+}
+
 void
-bar_display_wmstatus(int mtags[32], int mtagset, char *cname, int ctagset)
+bar_display_wmstatus(int mtags[32], int mtagset, const char *cname, int ctagset)
 {
-    if (! opened)
+    if (! opened || suspended())
         return;
 
     int pty, ptw, pcy;
@@ -439,6 +448,9 @@ bar_display_systatus()
 {
     char status[4096];
 
+    if (suspended())
+        return;
+
     xcb_icccm_get_text_property_reply_t name;
     xcb_icccm_get_wm_name_reply(
             g_xcb,
@@ -549,9 +561,14 @@ bar_display_systatus()
 void
 bar_close()
 {
-    if (opened) {
+    /* the bar may have been created but never shown */
+    if (window != XCB_NONE) {
+        xcb_free_gc(g_xcb, gcontext);
         xcb_free_pixmap(g_xcb, pixmap);
         xcb_destroy_window(g_xcb, window);
         xcb_close_font(g_xcb, font);
+        window = XCB_NONE;
     }
+    opened = false;
+    monitor = NULL;
 }
@@ -13,7 +13,7 @@ bool bar_is_monitor(Monitor *m);
 bool bar_is_window(xcb_window_t w);
 void bar_show();
 void bar_hide();
-void bar_display_wmstatus(int mtags[32], int mtagset, char *cname, int ctagset);
+void bar_display_wmstatus(int mtags[32], int mtagset, const char *cname, int ctagset);
 void bar_display_systatus();
 void bar_close();
 
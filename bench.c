@@ -0,0 +1,117 @@
+#include <stdlib.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+
+#include "bench.h"
+#include "client.h"
+#include "layout.h"
+#include "log.h"
+#include "monitor.h"
+#include "mosaic.h"
+#include "timer.h"
+#include "x11.h"
+
+/*
+ * fill the focused monitor with clients of our own and time the renders
+ * the user causes the most: nothing changed, another layout and another
+ * tag. to be run on a spare server, Xvfb will do, see --benchmark.
+ */
+
+#define ROUNDS 100
+
+static void measure(const char *name, void (*step)(int round));
+static void unchanged(int round);
+static void relayout(int round);
+static void switch_tag(int round);
+
+static Monitor  *monitor = NULL;
+static int      count = 0;
+
+void
+measure(const char *name, void (*step)(int round))
+{
+    struct timespec start;
+    long total = 0, max = 0;
+
+    for (int i = 0; i < ROUNDS; ++i) {
+        timer_now(&start);
+        step(i);
+        long elapsed = timer_elapsed(&start);
+
+        /* the server catches up off the clock */
+        xcb_aux_sync(g_xcb);
+        total += elapsed;
+        if (elapsed > max)
+            max = elapsed;
+    }
+
+    INFO("benchmark: %d clients, %s: avg %ld us, max %ld us.",
+            count, name, total / ROUNDS, max);
+}
+
+void
+unchanged(int round)
+{
+    (void)round;
+    monitor_render(monitor, GS_UNCHANGED);
+}
+
+void
+relayout(int round)
+{
+    focused_monitor_set_layout(round % 2 ? LT_GRID : LT_LEFT);
+}
+
+void
+switch_tag(int round)
+{
+    focused_monitor_set_tag(1 + round % 2);
+}
+
+void
+bench_run(int clients)
+{
+    xcb_window_t *windows = calloc(clients, sizeof(xcb_window_t));
+    if (! windows)
+        FATAL("can't allocate the benchmark windows.");
+
+    for (int i = 0; i < clients; ++i) {
+        windows[i] = xcb_generate_id(g_xcb);
+        xcb_create_window(
+                g_xcb,
+                XCB_COPY_FROM_PARENT,
+                windows[i],
+                g_root,
+                0, 0, 100, 100, 0,
+                XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                XCB_COPY_FROM_PARENT,
+                0,
+                NULL);
+        manage(windows[i]);
+    }
+    xcb_aux_sync(g_xcb);
+
+    Client *c = lookup(windows[0]);
+    if (c) {
+        monitor = c->monitor;
+        count = monitor->nclients;
+
+        measure("unchanged", unchanged);
+        measure("layout", relayout);
+
+        /* every other client on the second tag */
+        for (int i = 0; i < monitor->nclients; i += 2)
+            client_set_tagset(monitor->clients[i], 1L << 1);
+        measure("tag", switch_tag);
+
+        const RenderStats *rs = monitor_render_stats();
+        INFO("benchmark: %ld renders, %ld clients looked at.",
+                rs->renders, rs->clients);
+    }
+
+    for (int i = 0; i < clients; ++i)
+        xcb_destroy_window(g_xcb, windows[i]);
+    xcb_aux_sync(g_xcb);
+    free(windows);
+}
@@ -1,14 +1,21 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "client.h"
+#include "intern.h"
 #include "mosaic.h"
 #include "log.h"
 #include "monitor.h"
+#include "rules.h"
 #include "settings.h"
+#include "stack.h"
+#include "sync.h"
 #include "x11.h"
 
 static int xcb_reply_contains_atom(xcb_get_property_reply_t *reply, xcb_atom_t atom);
+static void grab_buttons(Client *c);
+static void forward_bypass_compositor(Client *c, int fullscreen);
 
 int
 xcb_reply_contains_atom(xcb_get_property_reply_t *reply, xcb_atom_t atom)
@@ -27,6 +34,26 @@ xcb_reply_contains_atom(xcb_get_property_reply_t *reply, xcb_atom_t atom)
     return 0;
 }
 
+/*
+ * clicks on an unfocused client go through us first to focus it, see
+ * on_button_press. the focused client gets its clicks directly.
+ */
+void
+grab_buttons(Client *c)
+{
+    xcb_grab_button(
+            g_xcb,
+            1,
+            c->window,
+            XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE,
+            XCB_GRAB_MODE_SYNC,
+            XCB_GRAB_MODE_SYNC,
+            XCB_NONE,
+            XCB_NONE,
+            XCB_BUTTON_INDEX_ANY,
+            XCB_MOD_MASK_ANY);
+}
+
 void
 client_initialize(Client *c, xcb_window_t w)
 {
@@ -34,25 +61,64 @@ client_initialize(Client *c, xcb_window_t w)
     c->tiling_geometry = (Rectangle) {0};
     c->floating_geometry = (Rectangle) {0};
     c->border_width = g_border_width;
-    c->border_color = g_normal_color;
+    c->info->displayed_border_width = -1;
+    c->info->border_color = g_normal_color;
     c->mode = MODE_TILED;
     c->state = STATE_ACCEPT_FOCUS;
-    c->strut = (Strut){0};
-    c->size_hints = (SizeHints){0};
+    c->info->strut = (Strut){0};
+    c->info->size_hints = (SizeHints){0};
     c->transient = XCB_NONE;
+    c->info->stack_rank = 0;
+    c->info->stack_index = -1;
     c->monitor = NULL;
     c->tagset = -1;
-    c->next = NULL;
-    c->prev = NULL;
+    c->slot = -1;
+    c->info->newer = NULL;
+    c->info->older = NULL;
+    c->info->next_fullscreen = NULL;
+    c->info->mapping = 0;
 
     xcb_change_save_set(g_xcb, XCB_SET_MODE_INSERT, w);
 
+    /* ask for everything at once, the replies are read below */
+    xcb_get_geometry_cookie_t geometry_cookie = xcb_get_geometry(g_xcb, w);
+    xcb_get_property_cookie_t transient_cookie = xcb_get_property(
+            g_xcb,
+            0,
+            w,
+            XCB_ATOM_WM_TRANSIENT_FOR,
+            XCB_GET_PROPERTY_TYPE_ANY,
+            0,
+            UINT32_MAX);
+    xcb_get_property_cookie_t class_cookie = xcb_get_property(
+            g_xcb,
+            0,
+            w,
+            XCB_ATOM_WM_CLASS,
+            XCB_ATOM_STRING,
+            0, -1);
+    xcb_get_property_cookie_t protocols_cookie = xcb_get_property(
+            g_xcb,
+            0,
+            w,
+            g_ewmh.WM_PROTOCOLS,
+            XCB_ATOM_ATOM,
+            0,
+            32);
+    xcb_get_property_cookie_t counter_cookie = xcb_get_property(
+            g_xcb,
+            0,
+            w,
+            g_ewmh._NET_WM_SYNC_REQUEST_COUNTER,
+            XCB_ATOM_CARDINAL,
+            0,
+            1);
+
     /* manage the geometry of the window */
-    /* TODO: xcb calls could be //lized */
     xcb_get_geometry_reply_t *geometry =
             xcb_get_geometry_reply(
                     g_xcb,
-                    xcb_get_geometry(g_xcb, w),
+                    geometry_cookie,
                     NULL);
 
     if (geometry) {
@@ -71,14 +137,7 @@ client_initialize(Client *c, xcb_window_t w)
 
     xcb_get_property_reply_t *transient = xcb_get_property_reply(
             g_xcb,
-            xcb_get_property(
-                    g_xcb,
-                    0,
-                    w,
-                    XCB_ATOM_WM_TRANSIENT_FOR,
-                    XCB_GET_PROPERTY_TYPE_ANY,
-                    0,
-                    UINT32_MAX),
+            transient_cookie,
             NULL);
 
     if (transient && xcb_get_property_value_length(transient) != 0) {
@@ -90,56 +149,51 @@ client_initialize(Client *c, xcb_window_t w)
 
     free(transient);
 
-    /* keep track of event of interrest */
+    /* keep track of event of interrest, the border is painted before
+     * the window is mapped */
     xcb_change_window_attributes(
             g_xcb,
             w,
-            XCB_CW_EVENT_MASK,
+            XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK,
             (const unsigned int []) {
+                c->info->border_color,
                 XCB_EVENT_MASK_ENTER_WINDOW |
                 XCB_EVENT_MASK_LEAVE_WINDOW |
                 XCB_EVENT_MASK_FOCUS_CHANGE |
                 XCB_EVENT_MASK_PROPERTY_CHANGE |
                 XCB_EVENT_MASK_STRUCTURE_NOTIFY });
 
-    /* grab buttons */
-    xcb_grab_button(
-            g_xcb,
-            1,
-            w,
-            XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE,
-            XCB_GRAB_MODE_SYNC,
-            XCB_GRAB_MODE_SYNC,
-            XCB_NONE,
-            XCB_NONE,
-            XCB_BUTTON_INDEX_ANY,
-            XCB_MOD_MASK_ANY);
+    grab_buttons(c);
 
     /* apply the rules */
+    c->info->instance = c->info->class = intern("Unknown");
     xcb_get_property_reply_t *cr = xcb_get_property_reply(
             g_xcb,
-            xcb_get_property(
-                    g_xcb,
-                    0,
-                    w,
-                    XCB_ATOM_WM_CLASS,
-                    XCB_ATOM_STRING,
-                    0, -1),
+            class_cookie,
             NULL);
     if (cr) {
+        /* two nul terminated strings, the last one may lack its nul */
         char *p = xcb_get_property_value(cr);
-        char *instance = p;
-        char *class = p + strlen(instance) + 1;
-        strncpy(c->instance, instance ? instance : "Unknown", 255);
-        strncpy(c->class, class ? class : "Unknown", 255);
-        int i = 0;
-        while (g_rules[i].class_name) {
-            if ((g_rules[i].instance_name && strcmp(g_rules[i].instance_name, instance) == 0) ||
-                (g_rules[i].class_name && strcmp(g_rules[i].class_name, class) == 0)) {
-                c->tagset = g_rules[i].tags;
-                c->mode = g_rules[i].mode;
-            }
-            i++;
+        int length = xcb_get_property_value_length(cr);
+        int n = strnlen(p, length);
+        char instance[256], class[256];
+
+        snprintf(instance, sizeof(instance), "%.*s", n, p);
+        if (n < length)
+            snprintf(class, sizeof(class), "%.*s", length - n - 1, p + n + 1);
+        else
+            class[0] = '\0';
+
+        if (instance[0])
+            c->info->instance = intern(instance);
+        if (class[0])
+            c->info->class = intern(class);
+
+        c->info->rule = rules_match(c->info->instance, c->info->class);
+        if (c->info->rule) {
+            c->tagset = c->info->rule->tags;
+            if (c->info->rule->mode != MODE_ANY)
+                c->mode = c->info->rule->mode;
         }
 
         free(cr);
@@ -150,6 +204,20 @@ client_initialize(Client *c, xcb_window_t w)
     client_update_size_hints(c);
     client_update_wm_hints(c);
     client_update_window_type(c);
+    c->info->bypass_forwarded = 0;
+    client_update_bypass_compositor(c);
+
+    xcb_get_property_reply_t *protocols = xcb_get_property_reply(
+            g_xcb,
+            protocols_cookie,
+            NULL);
+    xcb_get_property_reply_t *counter = xcb_get_property_reply(
+            g_xcb,
+            counter_cookie,
+            NULL);
+    sync_attach(c, protocols, counter);
+    free(protocols);
+    free(counter);
 
     /* apply hint size */
     client_apply_size_hints(c);
@@ -165,7 +233,7 @@ client_set_floating(Client *c, Rectangle *r)
 }
 
 void
-client_set_tiling(Client *c, Rectangle *r)
+client_set_tiling(Client *c, const Rectangle *r)
 {
     c->tiling_geometry = *r;
     c->tiling_geometry.width -= 2 * c->border_width;
@@ -175,15 +243,18 @@ client_set_tiling(Client *c, Rectangle *r)
 void
 client_set_mode(Client *c, Mode m)
 {
-    c->saved_mode = c->mode;
+    c->info->saved_mode = c->mode;
     c->mode = m;
+    if (c->monitor)
+        monitor_update_client(c->monitor, c);
 }
 
 void
 client_set_tagset(Client *c, int tagset)
 {
-    c->saved_tagset = c->tagset;
-    c->tagset = tagset;
+    c->info->saved_tagset = c->tagset;
+    monitor_retag(c->monitor, c, tagset);
+    client_update_visibility(c);
 }
 
 void
@@ -195,8 +266,10 @@ client_set_sticky(Client *c, int sticky)
         c->tiling_geometry = c->floating_geometry;
     } else {
         c->state &= ~ STATE_STICKY;
-        c->mode = c->saved_mode;
+        c->mode = c->info->saved_mode;
         c->floating_geometry = c->tiling_geometry;
+        if (c->monitor)
+            monitor_update_client(c->monitor, c);
     }
 }
 
@@ -209,11 +282,16 @@ client_set_fullscreen(Client *c, int fullscreen)
         c->tiling_geometry = c->floating_geometry;
         c->floating_geometry = c->monitor->geometry;
         client_set_mode(c, MODE_FULLSCREEN);
+        forward_bypass_compositor(c, 1);
     } else {
-        c->tagset = c->saved_tagset;
+        forward_bypass_compositor(c, 0);
+        monitor_retag(c->monitor, c, c->info->saved_tagset);
+        client_update_visibility(c);
         c->border_width = g_border_width;
-        c->mode = c->saved_mode;
+        c->mode = c->info->saved_mode;
         c->floating_geometry = c->tiling_geometry;
+        if (c->monitor)
+            monitor_update_client(c->monitor, c);
     }
 }
 
@@ -253,12 +331,10 @@ client_receive_focus(Client *c)
             XCB_CW_BORDER_PIXEL,
             (unsigned int []) { g_focused_color });
 
+    xcb_ungrab_button(g_xcb, XCB_BUTTON_INDEX_ANY, c->window, XCB_MOD_MASK_ANY);
+
     if (c->monitor->layout == LT_NONE || c->mode != MODE_TILED)
-        xcb_configure_window (
-                g_xcb,
-                c->window,
-                XCB_CONFIG_WINDOW_STACK_MODE,
-                (const unsigned int[]) { XCB_STACK_MODE_ABOVE });
+        stack_raise(c->monitor, c);
 }
 
 void
@@ -269,39 +345,32 @@ client_loose_focus(Client *c)
             c->window,
             XCB_CW_BORDER_PIXEL,
             (unsigned int []) { g_normal_color });
+
+    grab_buttons(c);
 }
 
 void
 client_hide(Client *c)
 {
+    /* nothing to show once the client is done drawing */
+    c->info->sync_deferred = 0;
+
+    if ((c->state & STATE_HIDDEN) == STATE_HIDDEN)
+        return;
+
     Rectangle g = c->mode == MODE_TILED ?
         c->tiling_geometry : c->floating_geometry;
 
-    /*
-     * "freeze" the window while moving it
-     * e.g don't get enter_event that triggers focus_in
-     * while moving a client
-     */
-    xcb_grab_pointer(
-                g_xcb,
-                0,
-                c->window,
-                XCB_NONE,
-                XCB_GRAB_MODE_SYNC,
-                XCB_GRAB_MODE_SYNC,
-                XCB_NONE,
-                XCB_NONE,
-                XCB_CURRENT_TIME);
-
-    xcb_configure_window(
+    /* the enter events this causes are dropped, see on_enter_notify */
+    g_layout_sequence = xcb_configure_window(
             g_xcb,
             c->window,
             XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y,
-            (const int []) { 
+            (const int []) {
                 -((int)g.width + 2 * c->border_width),
-                -((int)g.height + 2 * c->border_width) });
+                -((int)g.height + 2 * c->border_width) }).sequence;
 
-    xcb_ungrab_pointer(g_xcb, XCB_CURRENT_TIME);
+    c->state |= STATE_HIDDEN;
 }
 
 void
@@ -310,23 +379,24 @@ client_show(Client *c)
     Rectangle g = c->mode == MODE_TILED ?
         c->tiling_geometry : c->floating_geometry;
 
-    /*
-     * "freeze" the window while moving it
-     * e.g don't get enter_event that triggers focus_in
-     * while moving a client
-     */
-    xcb_grab_pointer(
-            g_xcb,
-            0,
-            c->window,
-            XCB_NONE,
-            XCB_GRAB_MODE_SYNC,
-            XCB_GRAB_MODE_SYNC,
-            XCB_NONE,
-            XCB_NONE,
-            XCB_CURRENT_TIME);
+    /* already there */
+    if ((c->state & STATE_HIDDEN) != STATE_HIDDEN &&
+            c->info->displayed_border_width == c->border_width &&
+            c->info->displayed_geometry.x == g.x &&
+            c->info->displayed_geometry.y == g.y &&
+            c->info->displayed_geometry.width == g.width &&
+            c->info->displayed_geometry.height == g.height)
+        return;
+
+    /* a client still drawing its previous size gets the latest one
+     * once it is done */
+    if (sync_request(c,
+                c->info->displayed_geometry.width != g.width ||
+                c->info->displayed_geometry.height != g.height))
+        return;
 
-    xcb_configure_window(
+    /* the enter events this causes are dropped, see on_enter_notify */
+    g_layout_sequence = xcb_configure_window(
             g_xcb,
             c->window,
             XCB_CONFIG_WINDOW_X |
@@ -337,29 +407,30 @@ client_show(Client *c)
             (const int []) {
                 g.x, g.y,
                 g.width, g.height,
-                c->border_width });
-
-    if (c->mode == MODE_TILED)
-        xcb_configure_window(
-                g_xcb,
-                c->window,
-                XCB_CONFIG_WINDOW_STACK_MODE,
-                (const int []) { XCB_STACK_MODE_BELOW });
+                c->border_width }).sequence;
 
-    if (c->mode == MODE_FULLSCREEN)
-        xcb_configure_window(
-                g_xcb,
-                c->window,
-                XCB_CONFIG_WINDOW_STACK_MODE,
-                (const int []) { XCB_STACK_MODE_ABOVE });
-
-    xcb_ungrab_pointer(g_xcb, XCB_CURRENT_TIME);
+    c->state &= ~STATE_HIDDEN;
+    c->info->displayed_geometry = g;
+    c->info->displayed_border_width = c->border_width;
 }
 
 int
 client_is_visible(Client *c)
 {
-    return (! c->tagset) || (c->tagset & c->monitor->tagset);
+    return (c->state & STATE_VISIBLE) == STATE_VISIBLE;
+}
+
+/* to be called whenever the tagset of the client or its monitor changes */
+void
+client_update_visibility(Client *c)
+{
+    if (c->monitor && ((! c->tagset) || (c->tagset & c->monitor->tagset)))
+        c->state |= STATE_VISIBLE;
+    else
+        c->state &= ~STATE_VISIBLE;
+
+    if (c->monitor)
+        monitor_update_client(c->monitor, c);
 }
 
 void
@@ -398,55 +469,102 @@ client_apply_size_hints(Client *c)
         return;
 
     /* handle the size aspect ratio */
-    double dx = c->floating_geometry.width - c->size_hints.base_width;
-    double dy = c->floating_geometry.height - c->size_hints.base_height;
+    double dx = c->floating_geometry.width - c->info->size_hints.base_width;
+    double dy = c->floating_geometry.height - c->info->size_hints.base_height;
     double ratio = dx / dy;
-    if (c->size_hints.max_aspect_ratio > 0 &&
-            c->size_hints.min_aspect_ratio > 0 && ratio > 0) {
-        if (ratio < c->size_hints.min_aspect_ratio) {
-            dy = dx / c->size_hints.min_aspect_ratio + 0.5;
-            c->floating_geometry.width  = dx + c->size_hints.base_width;
-            c->floating_geometry.height = dy + c->size_hints.base_height;
-        } else if (ratio > c->size_hints.max_aspect_ratio) {
-            dx = dy * c->size_hints.max_aspect_ratio + 0.5;
-            c->floating_geometry.width  = dx + c->size_hints.base_width;
-            c->floating_geometry.height = dy + c->size_hints.base_height;
+    if (c->info->size_hints.max_aspect_ratio > 0 &&
+            c->info->size_hints.min_aspect_ratio > 0 && ratio > 0) {
+        if (ratio < c->info->size_hints.min_aspect_ratio) {
+            dy = dx / c->info->size_hints.min_aspect_ratio + 0.5;
+            c->floating_geometry.width  = dx + c->info->size_hints.base_width;
+            c->floating_geometry.height = dy + c->info->size_hints.base_height;
+        } else if (ratio > c->info->size_hints.max_aspect_ratio) {
+            dx = dy * c->info->size_hints.max_aspect_ratio + 0.5;
+            c->floating_geometry.width  = dx + c->info->size_hints.base_width;
+            c->floating_geometry.height = dy + c->info->size_hints.base_height;
         }
     }
 
     /* handle the minimum size */
-    c->floating_geometry.width = MAX(c->floating_geometry.width, c->size_hints.min_width);
-    c->floating_geometry.height = MAX(c->floating_geometry.height, c->size_hints.min_height);
+    c->floating_geometry.width = MAX(c->floating_geometry.width, c->info->size_hints.min_width);
+    c->floating_geometry.height = MAX(c->floating_geometry.height, c->info->size_hints.min_height);
 
     /* handle the maximum size */
-    if (c->size_hints.max_width > 0)
-        c->floating_geometry.width = MIN(c->floating_geometry.width, c->size_hints.max_width);
-    if (c->size_hints.max_height > 0)
-        c->floating_geometry.height = MIN( c->floating_geometry.height, c->size_hints.max_height);
+    if (c->info->size_hints.max_width > 0)
+        c->floating_geometry.width = MIN(c->floating_geometry.width, c->info->size_hints.max_width);
+    if (c->info->size_hints.max_height > 0)
+        c->floating_geometry.height = MIN( c->floating_geometry.height, c->info->size_hints.max_height);
 
     /* handle the size increment */
-    if (c->size_hints.width_increment > 0 && c->size_hints.height_increment > 0) {
+    if (c->info->size_hints.width_increment > 0 && c->info->size_hints.height_increment > 0) {
         int t1 = c->floating_geometry.width;
         int t2 = c->floating_geometry.height;
-        if (c->size_hints.base_width > t1)
+        if (c->info->size_hints.base_width > t1)
             t1 = 0;
         else
-            t1 -= c->size_hints.base_width;
+            t1 -= c->info->size_hints.base_width;
 
-        if (c->size_hints.base_height > t2)
+        if (c->info->size_hints.base_height > t2)
             t2 = 0;
         else
-            t2 -= c->size_hints.base_height;
+            t2 -= c->info->size_hints.base_height;
+
+        c->floating_geometry.width -= t1 % c->info->size_hints.width_increment;
+        c->floating_geometry.height -= t2 % c->info->size_hints.height_increment;
+    }
+}
+
+/* 1 asks the compositor to unredirect the window, 2 asks it not to */
+void
+client_update_bypass_compositor(Client *c)
+{
+    /* our own change */
+    if (c->info->bypass_forwarded)
+        return;
+
+    c->info->bypass_compositor = 0;
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(
+            g_xcb,
+            xcb_get_property(
+                    g_xcb,
+                    0,
+                    c->window,
+                    g_atoms[NET_WM_BYPASS_COMPOSITOR],
+                    XCB_ATOM_CARDINAL,
+                    0,
+                    1),
+            NULL);
+
+    if (reply && xcb_get_property_value_length(reply) >= 4)
+        c->info->bypass_compositor = *(uint32_t *)xcb_get_property_value(reply);
+    free(reply);
+}
 
-        c->floating_geometry.width -= t1 % c->size_hints.width_increment;
-        c->floating_geometry.height -= t2 % c->size_hints.height_increment;
+/* a fullscreen client bypasses the compositor unless it asked not to,
+ * the compositor reads it on the client window */
+void
+forward_bypass_compositor(Client *c, int fullscreen)
+{
+    if (fullscreen && ! c->info->bypass_compositor && ! c->info->bypass_forwarded) {
+        xcb_change_property(
+                g_xcb,
+                XCB_PROP_MODE_REPLACE,
+                c->window,
+                g_atoms[NET_WM_BYPASS_COMPOSITOR],
+                XCB_ATOM_CARDINAL, 32, 1,
+                (const uint32_t []) { 1 });
+        c->info->bypass_forwarded = 1;
+    } else if (! fullscreen && c->info->bypass_forwarded) {
+        xcb_delete_property(g_xcb, c->window, g_atoms[NET_WM_BYPASS_COMPOSITOR]);
+        c->info->bypass_forwarded = 0;
     }
 }
 
 int
 client_update_strut(Client *c)
 {
-    c->strut = (Strut){0};
+    c->info->strut = (Strut){0};
+    c->state &= ~STATE_STRUT;
 
     xcb_ewmh_wm_strut_partial_t strut;
     if (xcb_ewmh_get_wm_strut_partial_reply(
@@ -454,10 +572,12 @@ client_update_strut(Client *c)
             xcb_ewmh_get_wm_strut_partial(&g_ewmh, c->window),
             &strut,
             NULL) == 1) {
-        c->strut.top = strut.top;
-        c->strut.bottom = strut.bottom;
-        c->strut.left = strut.left;
-        c->strut.right = strut.right;
+        c->info->strut.top = strut.top;
+        c->info->strut.bottom = strut.bottom;
+        c->info->strut.left = strut.left;
+        c->info->strut.right = strut.right;
+        if (strut.top || strut.bottom || strut.left || strut.right)
+            c->state |= STATE_STRUT;
         return 1;
     }
     return 0;
@@ -477,49 +597,49 @@ client_update_size_hints(Client *c)
         return 0;
     }
 
-    c->size_hints.base_width = c->size_hints.base_height = 0;
-    c->size_hints.width_increment = c->size_hints.height_increment = 0;
-    c->size_hints.max_width = c->size_hints.max_height = 0;
-    c->size_hints.min_width = c->size_hints.min_height = 0;
-    c->size_hints.max_aspect_ratio = c->size_hints.min_aspect_ratio = 0.0;
+    c->info->size_hints.base_width = c->info->size_hints.base_height = 0;
+    c->info->size_hints.width_increment = c->info->size_hints.height_increment = 0;
+    c->info->size_hints.max_width = c->info->size_hints.max_height = 0;
+    c->info->size_hints.min_width = c->info->size_hints.min_height = 0;
+    c->info->size_hints.max_aspect_ratio = c->info->size_hints.min_aspect_ratio = 0.0;
 
     xcb_size_hints_t size;
     if (xcb_icccm_get_wm_size_hints_from_reply(&size, normal_hints)) {
 
         /* base size */
         if (size.flags & XCB_ICCCM_SIZE_HINT_BASE_SIZE) {
-            c->size_hints.base_width = size.base_width;
-            c->size_hints.base_height = size.base_height;
+            c->info->size_hints.base_width = size.base_width;
+            c->info->size_hints.base_height = size.base_height;
         } else {
             /* note: not using min size as fallback */
-            c->size_hints.base_width = c->size_hints.base_height = 0;
+            c->info->size_hints.base_width = c->info->size_hints.base_height = 0;
         }
 
         /* max size */
         if (size.flags & XCB_ICCCM_SIZE_HINT_P_MAX_SIZE) {
-            c->size_hints.max_width = MAX(size.max_width, 1);
-            c->size_hints.max_height = MAX(size.max_height, 1);
+            c->info->size_hints.max_width = MAX(size.max_width, 1);
+            c->info->size_hints.max_height = MAX(size.max_height, 1);
         } else {
-            c->size_hints.max_width = c->size_hints.max_height = UINT32_MAX;
+            c->info->size_hints.max_width = c->info->size_hints.max_height = UINT32_MAX;
         }
 
         /* min size */
         if (size.flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE) {
-            c->size_hints.min_width = size.min_width;
-            c->size_hints.min_height = size.min_height;
+            c->info->size_hints.min_width = size.min_width;
+            c->info->size_hints.min_height = size.min_height;
         } else {
             /* according to ICCCM 4.1.23 base size
              * should be used as a fallback */
-            c->size_hints.min_width = c->size_hints.base_width;
-            c->size_hints.min_height = c->size_hints.base_height;
+            c->info->size_hints.min_width = c->info->size_hints.base_width;
+            c->info->size_hints.min_height = c->info->size_hints.base_height;
         }
 
         /* increments */
         if (size.flags & XCB_ICCCM_SIZE_HINT_P_RESIZE_INC) {
-            c->size_hints.width_increment = size.width_inc;
-            c->size_hints.height_increment = size.height_inc;
+            c->info->size_hints.width_increment = size.width_inc;
+            c->info->size_hints.height_increment = size.height_inc;
         } else {
-            c->size_hints.width_increment = c->size_hints.height_increment = 1;
+            c->info->size_hints.width_increment = c->info->size_hints.height_increment = 1;
         }
 
         /* aspect */
@@ -538,8 +658,8 @@ client_update_size_hints(Client *c)
             min_aspect_num = 1;
             min_aspect_den = UINT32_MAX;
         }
-        c->size_hints.max_aspect_ratio = (double)max_aspect_num / (double)max_aspect_den;
-        c->size_hints.min_aspect_ratio = (double)min_aspect_num / (double)min_aspect_den;
+        c->info->size_hints.max_aspect_ratio = (double)max_aspect_num / (double)max_aspect_den;
+        c->info->size_hints.min_aspect_ratio = (double)min_aspect_num / (double)min_aspect_den;
 
         /* XXX: the client should be "fixed" but definitely not "sticky"
         if (client->max_width && client->max_height &&
@@ -621,6 +741,7 @@ client_update_window_type(Client *c)
 
     if (xcb_reply_contains_atom(type, g_ewmh._NET_WM_WINDOW_TYPE_DOCK)) {
         c->state &= ~STATE_ACCEPT_FOCUS;
+        c->state |= STATE_DOCK;
         c->border_width = 0;
         client_set_sticky(c, 1);
         client_set_tagset(c, 0);
@@ -637,15 +758,14 @@ client_update_window_type(Client *c)
 Client *
 client_next(Client *c, Mode mode, State state)
 {
-    /* find the first successor matching */
-    for (Client *ic = c->next; ic; ic = ic->next)
-        if (CLIENT_MATCH_MODE_AND_STATE(ic, mode, state))
-            return ic;
+    Monitor *m = c->monitor;
 
-    /* if not found then find the first one matching from the head */
-    for (Client *ic = c->monitor->head; ic && ic != c; ic = ic->next)
+    /* find the first successor matching, then from the head */
+    for (int i = 1; i < m->nclients; ++i) {
+        Client *ic = m->clients[(c->slot + i) % m->nclients];
         if (CLIENT_MATCH_MODE_AND_STATE(ic, mode, state))
             return ic;
+    }
 
     return NULL;
 }
@@ -653,15 +773,14 @@ client_next(Client *c, Mode mode, State state)
 Client *
 client_previous(Client *c, Mode mode, State state)
 {
-    /* find the first ancestor matching */
-    for (Client *ic = c->prev; ic; ic = ic->prev)
-        if (CLIENT_MATCH_MODE_AND_STATE(ic, mode, state))
-            return ic;
+    Monitor *m = c->monitor;
 
-    /* if not found then find the first one matching from the tail */
-    for (Client *ic = c->monitor->tail; ic && ic != c; ic = ic->prev)
+    /* find the first ancestor matching, then from the tail */
+    for (int i = 1; i < m->nclients; ++i) {
+        Client *ic = m->clients[(c->slot - i + m->nclients) % m->nclients];
         if (CLIENT_MATCH_MODE_AND_STATE(ic, mode, state))
             return ic;
+    }
 
     return NULL;
 }
@@ -4,10 +4,14 @@
 #include <xcb/xcb.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/xcb_ewmh.h>
+#include <xcb/sync.h>
 
 #include "rectangle.h"
+#include "settings.h"
+#include "timer.h"
 
 typedef struct _Monitor Monitor;
+typedef struct _Client Client;
 
 typedef enum _Mode {
     MODE_ANY,
@@ -22,6 +26,10 @@ typedef int State;
 #define STATE_ACCEPT_FOCUS  0x01
 #define STATE_STICKY        0x02
 #define STATE_URGENT        0x04
+#define STATE_STRUT         0x08    /* reserves space, see ClientInfo */
+#define STATE_VISIBLE       0x10    /* on a tag shown by its monitor */
+#define STATE_HIDDEN        0x20    /* moved off screen */
+#define STATE_DOCK          0x40    /* stacked above everything */
 
 typedef struct _Strut {
     int top;
@@ -43,30 +51,56 @@ typedef struct _SizeHints {
     double  max_aspect_ratio;
 } SizeHints;
 
-typedef struct _Client {
+/* what the layouts don't look at */
+typedef struct _ClientInfo {
+    Mode            saved_mode;
+    int             saved_tagset;
+    int             instance;   /* interned WM_CLASS strings */
+    int             class;
+    int             border_color;
+    Strut           strut;
+    SizeHints       size_hints;
+    const Rule      *rule;      /* the rule applied, if any */
+    xcb_sync_counter_t  sync_counter;   /* none without _NET_WM_SYNC_REQUEST */
+    xcb_sync_alarm_t    sync_alarm;
+    uint64_t            sync_value;     /* last value requested */
+    int                 sync_waiting;   /* for the client to draw it */
+    int                 sync_deferred;  /* a geometry is not sent yet */
+    Timer               sync_timeout;
+    int                 bypass_compositor;  /* as asked by the client */
+    int                 bypass_forwarded;   /* set by us while fullscreen */
+    struct timespec     map_start;  /* of its map request, see mapped */
+    int                 mapping;    /* until its MapNotify */
+    Rectangle           displayed_geometry; /* as last sent to the server */
+    int                 displayed_border_width;
+    unsigned int        stack_rank;     /* when it was last raised */
+    int                 stack_index;    /* in its monitor stack, see stack.c */
+    Client              *newer;     /* focus history of its monitor */
+    Client              *older;
+    Client              *next_fullscreen;   /* counted as such by its monitor */
+} ClientInfo;
+
+/*
+ * what the render loops walk through. the clients of a monitor are
+ * kept in its arrays, in tiling order, see monitor_attach.
+ */
+struct _Client {
     xcb_window_t    window;
     Mode            mode;
-    Mode            saved_mode;
-    char            instance[256];
-    char            class[256];
+    State           state;
+    int             tagset;
+    int             slot;       /* in the arrays of its monitor */
     Rectangle       tiling_geometry;
     Rectangle       floating_geometry;
     int             border_width;
-    int             border_color;
-    State           state;
-    Strut           strut;
-    SizeHints       size_hints;
     xcb_window_t    transient;
     Monitor         *monitor;
-    int             tagset;
-    int             saved_tagset;
-    struct _Client  *prev;
-    struct _Client  *next;
-} Client;
+    ClientInfo      *info;
+};
 
 void client_initialize(Client *c, xcb_window_t w);
 void client_set_floating(Client *c, Rectangle *r);
-void client_set_tiling(Client *c, Rectangle *r);
+void client_set_tiling(Client *c, const Rectangle *r);
 void client_set_mode(Client *c, Mode m);
 void client_set_tagset(Client *c, int tagset);
 void client_set_sticky(Client *c, int sticky);
@@ -80,6 +114,8 @@ void client_show(Client *c);
 void client_apply_size_hints(Client *c);
 void client_notify(Client *c);
 int client_is_visible(Client *c);
+void client_update_visibility(Client *c);
+void client_update_bypass_compositor(Client *c);
 int client_update_strut(Client *c);
 int client_update_size_hints(Client *c);
 int client_update_wm_hints(Client *c);
@@ -0,0 +1,172 @@
+#include <xcb/xcb.h>
+
+#include "drag.h"
+#include "layout.h"
+#include "monitor.h"
+#include "mosaic.h"
+#include "timer.h"
+#include "x11.h"
+
+/*
+ * move or resize a floating client, or change the split of the tiled
+ * ones, while a button is held. the pointer position is only recorded
+ * on motion, the geometry is computed and sent from a timer once per
+ * frame of the monitor, after the main loop has read all the events
+ * queued.
+ */
+
+typedef enum _DragKind {
+    DRAG_MOVE,
+    DRAG_RESIZE,
+    DRAG_SPLIT
+} DragKind;
+
+static void update();
+static void on_frame(void *data);
+
+static Client           *client = NULL;
+static DragKind         kind;
+static int              press_x, press_y;
+static int              pointer_x, pointer_y;   /* last position */
+static Rectangle        origin;     /* geometry when the button was pressed */
+static float            split;
+static int              pending = 0;
+static struct timespec  last;       /* last update sent */
+static Timer            frame = { .callback = on_frame };
+static DragStats        stats;
+
+void
+update()
+{
+    int dx = pointer_x - press_x, dy = pointer_y - press_y;
+    Monitor *m = client->monitor;
+
+    pending = 0;
+    timer_now(&last);
+    stats.updates++;
+
+    switch (kind) {
+        case DRAG_MOVE:
+            client->floating_geometry.x = origin.x + dx;
+            client->floating_geometry.y = origin.y + dy;
+            client_show(client);
+            break;
+        case DRAG_RESIZE:
+            client->floating_geometry.width = MAX(1, origin.width + dx);
+            client->floating_geometry.height = MAX(1, origin.height + dy);
+            client_apply_size_hints(client);
+            client_show(client);
+            break;
+        case DRAG_SPLIT: {
+            /* the mains follow the pointer on their side of the split */
+            float s = split;
+            switch (m->layout) {
+                case LT_RIGHT:  s += (float)dx / m->geometry.width; break;
+                case LT_LEFT:   s -= (float)dx / m->geometry.width; break;
+                case LT_BOTTOM: s += (float)dy / m->geometry.height; break;
+                case LT_TOP:    s -= (float)dy / m->geometry.height; break;
+                default: break;
+            }
+            s = MAX(MAIN_SPLIT_MIN, MIN(MAIN_SPLIT_MAX, s));
+            if (s != m->split) {
+                m->split = s;
+                monitor_render(m, GS_UNCHANGED);
+            }
+            break;
+        }
+    }
+}
+
+void
+on_frame(void *data)
+{
+    (void)data;
+    if (client && pending)
+        update();
+}
+
+/* button 1 moves a floating client, button 3 resizes it, either one
+ * changes the split of a tiled client */
+void
+drag_start(Client *c, xcb_button_t button, int px, int py)
+{
+    if (client || c->mode == MODE_FULLSCREEN ||
+            (c->state & STATE_DOCK) == STATE_DOCK)
+        return;
+
+    if (c->mode == MODE_FLOATING) {
+        if (button == XCB_BUTTON_INDEX_1)
+            kind = DRAG_MOVE;
+        else if (button == XCB_BUTTON_INDEX_3)
+            kind = DRAG_RESIZE;
+        else
+            return;
+        origin = c->floating_geometry;
+    } else {
+        kind = DRAG_SPLIT;
+        split = c->monitor->split;
+    }
+
+    client = c;
+    press_x = pointer_x = px;
+    press_y = pointer_y = py;
+    pending = 0;
+    last = (struct timespec) {0};
+    stats.drags++;
+}
+
+void
+drag_motion(xcb_motion_notify_event_t *e)
+{
+    if (! client)
+        return;
+
+    stats.motions++;
+    pointer_x = e->root_x;
+    pointer_y = e->root_y;
+    if (pending)
+        return;
+
+    /* no sooner than a frame after the previous update */
+    long interval = 1000000 / MAX(1, client->monitor->refresh);
+    long wait = interval - timer_elapsed(&last);
+    pending = 1;
+    timer_arm(&frame, wait > 0 ? (wait + 999) / 1000 : 0);
+}
+
+void
+drag_stop(xcb_button_release_event_t *e)
+{
+    if (! client)
+        return;
+
+    pointer_x = e->root_x;
+    pointer_y = e->root_y;
+    update();
+    timer_disarm(&frame);
+    client = NULL;
+}
+
+/* the client is going away */
+void
+drag_forget(Client *c)
+{
+    if (client != c)
+        return;
+
+    timer_disarm(&frame);
+    client = NULL;
+    pending = 0;
+}
+
+int
+drag_is_active()
+{
+    return client != NULL;
+}
+
+const DragStats *
+drag_stats()
+{
+    return &stats;
+}
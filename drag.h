@@ -0,0 +1,21 @@
+#ifndef __DRAG_H__
+#define __DRAG_H__
+
+#include <xcb/xcb.h>
+
+#include "client.h"
+
+typedef struct _DragStats {
+    long    drags;
+    long    motions;    /* motion events received */
+    long    updates;    /* geometries sent, at most one per frame */
+} DragStats;
+
+void drag_start(Client *c, xcb_button_t button, int x, int y);
+void drag_motion(xcb_motion_notify_event_t *e);
+void drag_stop(xcb_button_release_event_t *e);
+void drag_forget(Client *c);
+int drag_is_active();
+const DragStats *drag_stats();
+
+#endif
@@ -1,5 +1,3 @@
-#include <unistd.h>
-
 #include <xcb/xcb.h>
 #include <xcb/xcb_aux.h>
 #include <xcb/xkb.h>
@@ -8,25 +6,54 @@
 
 #include "bar.h"
 #include "client.h"
+#include "drag.h"
 #include "events.h"
 #include "hints.h"
+#include "keyboard.h"
+#include "launcher.h"
 #include "log.h"
 #include "mosaic.h"
+#include "pool.h"
 #include "settings.h"
+#include "sync.h"
+#include "timer.h"
+#include "x11.h"
+
+/* delay gathering a burst of output changes into a single scan */
+#define HOTPLUG_DELAY 100
+
+typedef void (*Handler)(xcb_generic_event_t *e);
 
 static void on_expose(xcb_expose_event_t *e);
 static void on_configure_request(xcb_configure_request_event_t *e);
 static void on_configure_notify(xcb_configure_notify_event_t *e);
 static void on_map_request(xcb_map_request_event_t *e);
+static void on_map_notify(xcb_map_notify_event_t *e);
 static void on_unmap_notify(xcb_unmap_notify_event_t *e);
+static void on_destroy_notify(xcb_destroy_notify_event_t *e);
 static void on_property_notify(xcb_property_notify_event_t *e);
 static void on_focus_in(xcb_focus_in_event_t *e);
 static void on_focus_out(xcb_focus_out_event_t *e);
 static void on_enter_notify(xcb_enter_notify_event_t *e);
 static void on_client_message(xcb_client_message_event_t *e);
 static void on_button_press(xcb_button_press_event_t *e);
+static void on_button_release(xcb_button_release_event_t *e);
+static void on_motion_notify(xcb_motion_notify_event_t *e);
 static void on_key_press(xcb_key_press_event_t *e);
-static void spawn(char **argv);
+static void on_xkb_event(xcb_generic_event_t *e);
+static void on_randr_event(xcb_generic_event_t *e);
+static void on_hotplug(void *data);
+static void on_hover(void *data);
+
+/* extension events have no fixed response type, they are indexed once
+ * their base is known */
+static Handler      handlers[256];
+static Timer        hotplug = { .callback = on_hotplug };
+static Timer        hover = { .callback = on_hover };
+static xcb_window_t hovered = XCB_NONE;     /* to focus once the timer expires */
+static int          pointer_x = -1;     /* at the last enter event */
+static int          pointer_y = -1;
+static EnterStats   enter_stats;
 
 void
 on_configure_request(xcb_configure_request_event_t *e)
@@ -48,31 +75,18 @@ on_configure_request(xcb_configure_request_event_t *e)
 
             client_apply_size_hints(c);
 
-            if (e->value_mask & (XCB_CONFIG_WINDOW_X|XCB_CONFIG_WINDOW_Y) &&
-                    !(e->value_mask & (XCB_CONFIG_WINDOW_WIDTH |
-                            XCB_CONFIG_WINDOW_HEIGHT)))
+            /* a client on screen is sent through client_show, like the
+             * layout does. a hidden one, parked or on another tag, is
+             * only told where it will be. */
+            if (! client_is_visible(c) ||
+                    (c->state & STATE_HIDDEN) == STATE_HIDDEN) {
                 client_notify(c);
-
-            if (client_is_visible(c)) {
-                int x = c->floating_geometry.x;
-                int y = c->floating_geometry.y;
-                int w = c->floating_geometry.width;
-                int h = c->floating_geometry.height;
-
-                // XXX tiling geometry really??
-                if ((c->state & STATE_STICKY) == STATE_STICKY) {
-                    x = c->monitor->geometry.x + c->tiling_geometry.x;
-                    y = c->monitor->geometry.y + c->tiling_geometry.y;
-                }
-                xcb_configure_window(
-                        g_xcb,
-                        c->window,
-                        XCB_CONFIG_WINDOW_X |
-                        XCB_CONFIG_WINDOW_Y |
-                        XCB_CONFIG_WINDOW_WIDTH |
-                        XCB_CONFIG_WINDOW_HEIGHT |
-                        XCB_CONFIG_WINDOW_BORDER_WIDTH,
-                        (const int []) {x, y, w, h, c->border_width });
+            } else {
+                client_show(c);
+                if (e->value_mask & (XCB_CONFIG_WINDOW_X|XCB_CONFIG_WINDOW_Y) &&
+                        !(e->value_mask & (XCB_CONFIG_WINDOW_WIDTH |
+                                XCB_CONFIG_WINDOW_HEIGHT)))
+                    client_notify(c);
             }
         } else {
             /* Resend as notify */
@@ -103,7 +117,7 @@ void
 on_configure_notify(xcb_configure_notify_event_t *e)
 {
     if (e->window == g_root)
-        scan_monitors();
+        timer_arm(&hotplug, HOTPLUG_DELAY);
 }
 
 void
@@ -118,18 +132,18 @@ on_map_request(xcb_map_request_event_t *e)
             xcb_get_window_attributes(g_xcb, e->window),
             NULL);
 
-    if (attributes && ! attributes->override_redirect)
+    if (attributes && ! attributes->override_redirect &&
+            ! pool_adopt(e->window))
         manage(e->window);
 
     free(attributes);
 }
 
-/* TODO
-static void on_mapping_notify(xcb_mapping_notify_event_t *e)
+void
+on_map_notify(xcb_map_notify_event_t *e)
 {
-    TODO: Keyboard Change
+    mapped(e->window);
 }
-*/
 
 void
 on_unmap_notify(xcb_unmap_notify_event_t *e)
@@ -137,6 +151,12 @@ on_unmap_notify(xcb_unmap_notify_event_t *e)
     forget(e->window);
 }
 
+void
+on_destroy_notify(xcb_destroy_notify_event_t *e)
+{
+    pool_forget(e->window);
+}
+
 void
 on_property_notify(xcb_property_notify_event_t *e)
 {
@@ -172,9 +192,17 @@ on_property_notify(xcb_property_notify_event_t *e)
         if (client_update_window_type(client))
             refresh = 1;
 
+    if (e->atom == g_atoms[NET_WM_BYPASS_COMPOSITOR])
+        client_update_bypass_compositor(client);
+
     if (e->atom == g_ewmh._NET_WM_STRUT_PARTIAL)
-        if (client_update_strut(client))
+        if (client_update_strut(client)) {
+            monitor_update_struts(client->monitor);
             refresh = 1;
+        }
+
+    /* the mode, focus or strut of the client may have changed */
+    monitor_update_client(client->monitor, client);
 
     if (refresh) {
         monitor_render(client->monitor, GS_UNCHANGED);
@@ -239,14 +267,65 @@ on_focus_out(xcb_focus_out_event_t *e)
 void
 on_enter_notify(xcb_enter_notify_event_t *e)
 {
-    if(e->mode != XCB_NOTIFY_MODE_NORMAL || e->event == g_root)
+    if(e->mode != XCB_NOTIFY_MODE_NORMAL || drag_is_active())
+        return;
+
+    int moved = e->root_x != pointer_x || e->root_y != pointer_y;
+    pointer_x = e->root_x;
+    pointer_y = e->root_y;
+    if (e->event == g_root) {
+        /* the pointer left the window it was about to focus */
+        if (hovered != XCB_NONE) {
+            timer_disarm(&hover);
+            hovered = XCB_NONE;
+            enter_stats.discarded++;
+        }
         return;
+    }
+
+    /* the window came under the pointer because we moved or restacked
+     * it: the event was generated before the server got past our last
+     * layout request, or the pointer is where it was at the previous
+     * one. the 16 bits sequence on the wire would wrap after 32k
+     * requests, xcb keeps the full one. */
+    unsigned int sequence = ((xcb_generic_event_t *)e)->full_sequence;
+    if ((int)(sequence - g_layout_sequence) <= 0 || ! moved) {
+        enter_stats.dropped++;
+        return;
+    }
+
+    if (g_focus_delay) {
+        /* the focus goes where the pointer rests, the windows crossed
+         * on the way are forgotten */
+        if (hovered != XCB_NONE)
+            enter_stats.discarded++;
+        hovered = e->event;
+        timer_arm(&hover, g_focus_delay);
+        return;
+    }
 
     Client *c = lookup(e->event);
+    if (! c)
+        return;
+
+    enter_stats.handled++;
     client_set_input_focus(c);
     xcb_flush(g_xcb);
 }
 
+void
+on_hover(void *data)
+{
+    (void)data;
+    Client *c = lookup(hovered);
+    hovered = XCB_NONE;
+    if (! c)
+        return;
+
+    enter_stats.handled++;
+    client_set_input_focus(c);
+}
+
 void
 on_client_message(xcb_client_message_event_t *e)
 {
@@ -303,6 +382,8 @@ on_client_message(xcb_client_message_event_t *e)
         }
 #undef STATE
 
+        monitor_update_client(c->monitor, c);
+
         int count = 0;
         xcb_atom_t atoms[2];
 
@@ -326,24 +407,18 @@ void
 on_button_press(xcb_button_press_event_t *e)
 {
     if(e->event == g_root) {
-        focus_clicked_monitor(e->root_x, e->root_y);
+        Client *c = e->child != XCB_NONE ? lookup(e->child) : NULL;
+        if (c && (e->state & MODKEY)) {
+            client_set_input_focus(c);
+            drag_start(c, e->detail, e->root_x, e->root_y);
+        } else {
+            focus_clicked_monitor(e->root_x, e->root_y);
+        }
         return;
     }
 
-    if (bar_is_window(e->event)) {
-        if (fork() == 0) {
-            int pid = fork();
-            if (pid == 0) {
-                if (g_xcb)
-                    close(xcb_get_file_descriptor(g_xcb));
-                setsid();
-                system("uxterm");
-                exit(EXIT_SUCCESS);
-            }
-            if (pid > 0)
-                exit(EXIT_SUCCESS);
-        }
-    }
+    if (bar_is_window(e->event))
+        launcher_run(&g_bar_binding);
 
     Client *c = lookup(e->event);
 
@@ -357,85 +432,120 @@ on_button_press(xcb_button_press_event_t *e)
     //            c->window,
     //            XCB_CURRENT_TIME);
 
+    /* the client was unfocused, it still gets the click */
     xcb_allow_events(g_xcb, XCB_ALLOW_REPLAY_POINTER, XCB_CURRENT_TIME);
     xcb_flush(g_xcb);
 }
 
-/* TODO
 void
-on_keyboard_state_change(xcb_xkb_state_notify_event_t *e)
+on_button_release(xcb_button_release_event_t *e)
 {
-     * Just keep track of modifiers for now.
-     * keyboard or keymap changes etc.. see i3 or i3lock
-    xkb_state_update_mask(
-            g_xkb_state,
-            e->baseMods,
-            e->latchedMods,
-            e->lockedMods,
-            e->baseGroup,
-            e->latchedGroup,
-            e->lockedGroup);
+    drag_stop(e);
 }
-*/
 
+/* only received while dragging, the position is kept until the next
+ * frame, see drag.c */
 void
-on_key_press(xcb_key_press_event_t *e)
+on_motion_notify(xcb_motion_notify_event_t *e)
 {
-    xkb_keycode_t keycode = e->detail;
-    xkb_keysym_t keysym = xkb_state_key_get_one_sym(g_xkb_state, keycode);
-
-    int i = 0;
-    while (g_shortcuts[i].callback.vcb != NULL) {
-        if (g_shortcuts[i].sequence.modifier == e->state &&
-                g_shortcuts[i].sequence.keysym == keysym) {
-            switch (g_shortcuts[i].type) {
-                case CB_VOID:
-                    g_shortcuts[i].callback.vcb();
-                    break;
-                case CB_INT:
-                    g_shortcuts[i].callback.icb(g_shortcuts[i].args[0]);
-                    break;
-                case CB_INT_INT:
-                    g_shortcuts[i].callback.iicb(
-                            g_shortcuts[i].args[0],
-                            g_shortcuts[i].args[1]);
-                    break;
-            }
+    drag_motion(e);
+}
+
+void
+on_xkb_event(xcb_generic_event_t *e)
+{
+    switch (((xcb_xkb_any_event_t *)e)->xkbType) {
+        case XCB_XKB_STATE_NOTIFY:
+            keyboard_update_state((xcb_xkb_state_notify_event_t *)e);
+            break;
+        case XCB_XKB_MAP_NOTIFY:
+            keyboard_update_keymap(((xcb_xkb_map_notify_event_t *)e)->deviceID);
+            break;
+        case XCB_XKB_NEW_KEYBOARD_NOTIFY: {
+            xcb_xkb_new_keyboard_notify_event_t *nkn;
+            nkn = (xcb_xkb_new_keyboard_notify_event_t *)e;
+            if (nkn->changed & XCB_XKB_NKN_DETAIL_KEYCODES)
+                keyboard_update_keymap(nkn->deviceID);
+            break;
         }
-        i++;
     }
+    xcb_flush(g_xcb);
+}
 
-    i = 0;
-    while (g_bindings[i].args[0] != NULL) {
-        if (g_bindings[i].sequence.modifier == e->state &&
-                g_bindings[i].sequence.keysym == keysym)
-            spawn((char**)g_bindings[i].args);
-        i++;
-    }
+void
+on_randr_event(xcb_generic_event_t *e)
+{
+    (void)e;
+    timer_arm(&hotplug, HOTPLUG_DELAY);
 }
 
 void
-spawn(char **argv)
+on_hotplug(void *data)
+{
+    (void)data;
+    scan_monitors();
+}
+
+void
+on_key_press(xcb_key_press_event_t *e)
 {
-    if (fork() == 0) {
-        int pid = fork();
-        if (pid == 0) {
-            if (g_xcb)
-                close(xcb_get_file_descriptor(g_xcb));
-            setsid();
-            execvp(argv[0], argv);
-            exit(EXIT_SUCCESS);
+    Key *k = keyboard_lookup(e->state, e->detail);
+
+    if (! k)
+        return;
+
+    if (k->shortcut) {
+        switch (k->shortcut->type) {
+            case CB_VOID:
+                k->shortcut->callback.vcb();
+                break;
+            case CB_INT:
+                k->shortcut->callback.icb(k->shortcut->args[0]);
+                break;
+            case CB_INT_INT:
+                k->shortcut->callback.iicb(
+                        k->shortcut->args[0],
+                        k->shortcut->args[1]);
+                break;
         }
-        if (pid > 0)
-            exit(EXIT_SUCCESS);
+    }
 
+    if (k->binding) {
+        xcb_window_t w = k->binding->pool ? pool_take(k->binding) : XCB_NONE;
+        if (w != XCB_NONE)
+            manage(w);
+        else
+            launcher_run(k->binding);
     }
 }
 
+void
+events_setup()
+{
+    handlers[g_xkb_base_event] = on_xkb_event;
+    handlers[g_randr_base_event + XCB_RANDR_SCREEN_CHANGE_NOTIFY] = on_randr_event;
+    handlers[g_randr_base_event + XCB_RANDR_NOTIFY] = on_randr_event;
+    if (g_sync_base_event)
+        handlers[g_sync_base_event + XCB_SYNC_ALARM_NOTIFY] = sync_on_alarm;
+}
+
+const EnterStats *
+events_enter_stats()
+{
+    return &enter_stats;
+}
+
 void
 on_event(xcb_generic_event_t *event)
 {
-    switch(event->response_type & ~0x80) {
+    uint8_t type = event->response_type & ~0x80;
+
+    if (handlers[type]) {
+        handlers[type](event);
+        return;
+    }
+
+    switch(type) {
         case XCB_EXPOSE:
             on_expose((xcb_expose_event_t*)event);
             break;
@@ -448,14 +558,15 @@ on_event(xcb_generic_event_t *event)
         case XCB_MAP_REQUEST:
             on_map_request((xcb_map_request_event_t *)event);
             break;
-        /*
-        case XCB_MAPPING_NOTIFY:
-            on_mapping_notify((xcb_mapping_notify_event_t *)event);
+        case XCB_MAP_NOTIFY:
+            on_map_notify((xcb_map_notify_event_t *)event);
             break;
-        */
         case XCB_UNMAP_NOTIFY:
             on_unmap_notify((xcb_unmap_notify_event_t *)event);
             break;
+        case XCB_DESTROY_NOTIFY:
+            on_destroy_notify((xcb_destroy_notify_event_t *)event);
+            break;
         case XCB_PROPERTY_NOTIFY:
             on_property_notify((xcb_property_notify_event_t *)event);
             break;
@@ -474,12 +585,14 @@ on_event(xcb_generic_event_t *event)
         case XCB_BUTTON_PRESS:
             on_button_press((xcb_button_press_event_t *)event);
             break;
+        case XCB_BUTTON_RELEASE:
+            on_button_release((xcb_button_release_event_t *)event);
+            break;
+        case XCB_MOTION_NOTIFY:
+            on_motion_notify((xcb_motion_notify_event_t *)event);
+            break;
         case XCB_KEY_PRESS:
             on_key_press((xcb_key_press_event_t *)event);
             break;
-        /* Doesn't seem to be triggered?? */
-        case XCB_RANDR_SCREEN_CHANGE_NOTIFY:
-            scan_monitors();
-            break;
     }
 }
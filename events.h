@@ -3,6 +3,14 @@
 
 #include <xcb/xcb.h>
 
+typedef struct _EnterStats {
+    long    handled;
+    long    dropped;    /* caused by the layout, not by the pointer */
+    long    discarded;  /* crossed before the focus delay expired */
+} EnterStats;
+
+void events_setup();
+const EnterStats *events_enter_stats();
 void on_event(xcb_generic_event_t *event);
 
 #endif
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern.h"
+#include "log.h"
+
+static unsigned int hash(const char *s);
+static int *probe(const char *s);
+static void grow();
+
+/* strings are never released before intern_cleanup(), there is one per
+ * application class and instance seen */
+static char         **strings = NULL;   /* indexed by handle */
+static int          count = 0;          /* handles in use, 0 included */
+static int          capacity = 0;
+static int          *slots = NULL;      /* handles, 0 when empty */
+static unsigned int size = 0;
+
+/* FNV-1a */
+unsigned int
+hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+    while (*s)
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+/* return the slot holding the string, or the empty slot where it belongs */
+int *
+probe(const char *s)
+{
+    unsigned int i = hash(s) & (size - 1);
+
+    while (slots[i] && strcmp(strings[slots[i]], s) != 0)
+        i = (i + 1) & (size - 1);
+
+    return &slots[i];
+}
+
+/* double the table, it is kept at most half full */
+void
+grow()
+{
+    int *old = slots;
+    unsigned int old_size = size;
+
+    size = size ? size * 2 : 64;
+    slots = calloc(size, sizeof(int));
+    if (! slots)
+        FATAL("can't allocate the intern table.");
+
+    for (unsigned int i = 0; i < old_size; ++i)
+        if (old[i])
+            *probe(strings[old[i]]) = old[i];
+
+    free(old);
+}
+
+int
+intern(const char *s)
+{
+    if (! s)
+        return 0;
+
+    if (2 * (unsigned int)count >= size)
+        grow();
+
+    int *slot = probe(s);
+    if (*slot)
+        return *slot;
+
+    if (count + 1 >= capacity) {
+        capacity = capacity ? capacity * 2 : 64;
+        strings = realloc(strings, capacity * sizeof(char *));
+        if (! strings)
+            FATAL("can't allocate the intern strings.");
+        if (! count)
+            strings[count++] = NULL;
+    }
+
+    strings[count] = strdup(s);
+    if (! strings[count])
+        FATAL("can't intern %s.", s);
+
+    return *slot = count++;
+}
+
+/* the handle of an already interned string, 0 otherwise */
+int
+intern_find(const char *s)
+{
+    if (! s || ! size)
+        return 0;
+
+    return *probe(s);
+}
+
+const char *
+intern_string(int handle)
+{
+    return handle > 0 && handle < count ? strings[handle] : NULL;
+}
+
+void
+intern_cleanup()
+{
+    for (int i = 1; i < count; ++i)
+        free(strings[i]);
+    free(strings);
+    free(slots);
+    strings = NULL;
+    slots = NULL;
+    count = capacity = 0;
+    size = 0;
+}
@@ -0,0 +1,13 @@
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+/*
+ * strings stored once and referred to by a handle, equal strings get
+ * equal handles. 0 is the handle of no string.
+ */
+int intern(const char *s);
+int intern_find(const char *s);
+const char *intern_string(int handle);
+void intern_cleanup();
+
+#endif
@@ -0,0 +1,384 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xkb.h>
+#include <xkbcommon/xkbcommon.h>
+#include <xkbcommon/xkbcommon-x11.h>
+
+#include "keyboard.h"
+#include "log.h"
+#include "settings.h"
+#include "x11.h"
+
+#define KEYCODES 256
+#define MODIFIERS_MASK (XCB_MOD_MASK_SHIFT |\
+                        XCB_MOD_MASK_LOCK |\
+                        XCB_MOD_MASK_CONTROL |\
+                        XCB_MOD_MASK_1 |\
+                        XCB_MOD_MASK_2 |\
+                        XCB_MOD_MASK_3 |\
+                        XCB_MOD_MASK_4 |\
+                        XCB_MOD_MASK_5)
+
+static unsigned int clean(unsigned int modifier);
+static unsigned int hash(unsigned int modifier, xkb_keysym_t keysym);
+static Key *probe(unsigned int modifier, xkb_keysym_t keysym);
+static void insert(KeySequence *sequence, Shortcut *shortcut, Binding *binding);
+static void update_keysyms();
+static void update_lock_mask();
+static int is_bound(xkb_keysym_t keysym);
+static void grab_keycode(xkb_keycode_t keycode);
+static void grab_keys();
+static void grab_buttons();
+static void regrab_keys(xkb_keysym_t *previous, unsigned int previous_lock_mask);
+
+static struct xkb_context   *context = NULL;
+static struct xkb_keymap    *keymap = NULL;
+static int32_t              device = -1;
+static xkb_layout_index_t   layout = 0;
+static Key                  *keys = NULL;
+static unsigned int         size = 0;
+static unsigned int         lock_mask = XCB_MOD_MASK_LOCK;
+static xkb_keysym_t         keysyms[KEYCODES];
+
+/* remove the lock modifiers and the pointer buttons from a key state */
+unsigned int
+clean(unsigned int modifier)
+{
+    return modifier & MODIFIERS_MASK & ~lock_mask;
+}
+
+unsigned int
+hash(unsigned int modifier, xkb_keysym_t keysym)
+{
+    unsigned int h = keysym * 2654435761u;
+    h ^= modifier * 0x9e3779b9u;
+    return h ^ (h >> 16);
+}
+
+/* return the slot of the given sequence, or the empty slot where it belongs */
+Key *
+probe(unsigned int modifier, xkb_keysym_t keysym)
+{
+    unsigned int i = hash(modifier, keysym) & (size - 1);
+
+    while (keys[i].shortcut || keys[i].binding) {
+        if (keys[i].sequence.modifier == modifier &&
+                keys[i].sequence.keysym == keysym)
+            break;
+        i = (i + 1) & (size - 1);
+    }
+
+    return &keys[i];
+}
+
+void
+insert(KeySequence *sequence, Shortcut *shortcut, Binding *binding)
+{
+    unsigned int modifier = clean(sequence->modifier);
+    Key *k = probe(modifier, sequence->keysym);
+
+    if ((shortcut && k->shortcut) || (binding && k->binding)) {
+        INFO("key sequence 0x%x + 0x%x bound twice, keeping the first one.",
+                sequence->modifier,
+                sequence->keysym);
+        return;
+    }
+
+    k->sequence.modifier = modifier;
+    k->sequence.keysym = sequence->keysym;
+    if (shortcut)
+        k->shortcut = shortcut;
+    if (binding)
+        k->binding = binding;
+}
+
+/* cache the unmodified keysym of each keycode in the current layout */
+void
+update_keysyms()
+{
+    xkb_keycode_t min = xkb_keymap_min_keycode(keymap);
+    xkb_keycode_t max = xkb_keymap_max_keycode(keymap);
+
+    layout = xkb_state_serialize_layout(g_xkb_state, XKB_STATE_LAYOUT_EFFECTIVE);
+
+    memset(keysyms, 0, sizeof(keysyms));
+    for (xkb_keycode_t kc = min; kc <= max && kc < KEYCODES; ++kc) {
+        const xkb_keysym_t *syms;
+        xkb_layout_index_t l = xkb_state_key_get_layout(g_xkb_state, kc);
+        if (xkb_keymap_key_get_syms_by_level(keymap, kc, l, 0, &syms) > 0)
+            keysyms[kc] = syms[0];
+    }
+}
+
+/* find which modifier num lock is bound to */
+void
+update_lock_mask()
+{
+    lock_mask = XCB_MOD_MASK_LOCK;
+
+    xcb_get_modifier_mapping_reply_t *reply = xcb_get_modifier_mapping_reply(
+            g_xcb,
+            xcb_get_modifier_mapping(g_xcb),
+            NULL);
+
+    if (! reply)
+        return;
+
+    xcb_keycode_t *kcs = xcb_get_modifier_mapping_keycodes(reply);
+    for (int i = 0; i < 8; ++i)
+        for (int j = 0; j < reply->keycodes_per_modifier; ++j)
+            if (keysyms[kcs[i * reply->keycodes_per_modifier + j]] == XKB_KEY_Num_Lock)
+                lock_mask |= (1 << i);
+
+    free(reply);
+}
+
+int
+is_bound(xkb_keysym_t keysym)
+{
+    for (unsigned int i = 0; i < size; ++i)
+        if ((keys[i].shortcut || keys[i].binding) &&
+                keys[i].sequence.keysym == keysym)
+            return 1;
+
+    return 0;
+}
+
+/* grab the keycode for each sequence using its keysym, whatever the
+ * state of the lock modifiers */
+void
+grab_keycode(xkb_keycode_t keycode)
+{
+    unsigned int numlock = lock_mask & ~XCB_MOD_MASK_LOCK;
+    unsigned int locks[] = {
+        0,
+        XCB_MOD_MASK_LOCK,
+        numlock,
+        XCB_MOD_MASK_LOCK | numlock };
+
+    if (keysyms[keycode] == XKB_KEY_NoSymbol)
+        return;
+
+    for (unsigned int i = 0; i < size; ++i) {
+        if ((! keys[i].shortcut && ! keys[i].binding) ||
+                keys[i].sequence.keysym != keysyms[keycode])
+            continue;
+
+        for (int l = 0; l < 4; ++l)
+            xcb_grab_key(
+                    g_xcb,
+                    1,
+                    g_root,
+                    keys[i].sequence.modifier | locks[l],
+                    keycode,
+                    XCB_GRAB_MODE_ASYNC,
+                    XCB_GRAB_MODE_ASYNC);
+    }
+}
+
+void
+grab_keys()
+{
+    xcb_ungrab_key(g_xcb, XCB_GRAB_ANY, g_root, XCB_MOD_MASK_ANY);
+    for (xkb_keycode_t kc = 0; kc < KEYCODES; ++kc)
+        grab_keycode(kc);
+    grab_buttons();
+}
+
+/* the modifier with button 1 or 3 drags the client under the pointer,
+ * see drag.c. the root grab goes before those of the clients. */
+void
+grab_buttons()
+{
+    unsigned int numlock = lock_mask & ~XCB_MOD_MASK_LOCK;
+    unsigned int locks[] = {
+        0,
+        XCB_MOD_MASK_LOCK,
+        numlock,
+        XCB_MOD_MASK_LOCK | numlock };
+
+    xcb_ungrab_button(g_xcb, XCB_BUTTON_INDEX_ANY, g_root, XCB_MOD_MASK_ANY);
+    for (int l = 0; l < 4; ++l) {
+        for (int b = XCB_BUTTON_INDEX_1; b <= XCB_BUTTON_INDEX_3; b += 2)
+            xcb_grab_button(
+                    g_xcb,
+                    0,
+                    g_root,
+                    XCB_EVENT_MASK_BUTTON_PRESS |
+                    XCB_EVENT_MASK_BUTTON_RELEASE |
+                    XCB_EVENT_MASK_POINTER_MOTION,
+                    XCB_GRAB_MODE_ASYNC,
+                    XCB_GRAB_MODE_ASYNC,
+                    XCB_NONE,
+                    XCB_NONE,
+                    b,
+                    MODKEY | locks[l]);
+    }
+}
+
+/* only touch the keycodes whose keysym changed since the last grab */
+void
+regrab_keys(xkb_keysym_t *previous, unsigned int previous_lock_mask)
+{
+    if (lock_mask != previous_lock_mask) {
+        grab_keys();
+        return;
+    }
+
+    for (xkb_keycode_t kc = 0; kc < KEYCODES; ++kc) {
+        if (previous[kc] == keysyms[kc])
+            continue;
+
+        if (is_bound(previous[kc]))
+            xcb_ungrab_key(g_xcb, kc, g_root, XCB_MOD_MASK_ANY);
+        grab_keycode(kc);
+    }
+}
+
+void
+keyboard_setup()
+{
+    context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    device = xkb_x11_get_core_keyboard_device_id(g_xcb);
+    keymap = xkb_x11_keymap_new_from_device(
+            context,
+            g_xcb,
+            device,
+            XKB_KEYMAP_COMPILE_NO_FLAGS);
+    g_xkb_state = xkb_x11_state_new_from_device(
+            keymap,
+            g_xcb,
+            device);
+    int map = XCB_XKB_EVENT_TYPE_STATE_NOTIFY |
+              XCB_XKB_EVENT_TYPE_MAP_NOTIFY |
+              XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY;
+    int parts = XCB_XKB_MAP_PART_KEY_TYPES |
+                XCB_XKB_MAP_PART_KEY_SYMS |
+                XCB_XKB_MAP_PART_MODIFIER_MAP |
+                XCB_XKB_MAP_PART_EXPLICIT_COMPONENTS |
+                XCB_XKB_MAP_PART_KEY_ACTIONS |
+                XCB_XKB_MAP_PART_KEY_BEHAVIORS |
+                XCB_XKB_MAP_PART_VIRTUAL_MODS |
+                XCB_XKB_MAP_PART_VIRTUAL_MOD_MAP;
+    xcb_xkb_select_events(
+            g_xcb,
+            XCB_XKB_ID_USE_CORE_KBD,
+            map,
+            0,
+            map,
+            parts,
+            parts,
+            0);
+
+    update_keysyms();
+    update_lock_mask();
+
+    /* index shortcuts and bindings by (modifier, keysym), the table is
+     * kept at most half full so a miss ends quickly */
+    unsigned int count = 0;
+    for (int i = 0; g_shortcuts[i].callback.vcb != NULL; ++i)
+        count++;
+    for (int i = 0; g_bindings[i].args[0] != NULL; ++i)
+        count++;
+
+    size = 16;
+    while (size < 2 * count)
+        size <<= 1;
+    keys = calloc(size, sizeof(Key));
+    if (! keys)
+        FATAL("can't allocate the key table.");
+
+    for (int i = 0; g_shortcuts[i].callback.vcb != NULL; ++i)
+        insert(&g_shortcuts[i].sequence, &g_shortcuts[i], NULL);
+    for (int i = 0; g_bindings[i].args[0] != NULL; ++i)
+        insert(&g_bindings[i].sequence, NULL, &g_bindings[i]);
+
+    grab_keys();
+}
+
+void
+keyboard_update_state(xcb_xkb_state_notify_event_t *e)
+{
+    xkb_state_update_mask(
+            g_xkb_state,
+            e->baseMods,
+            e->latchedMods,
+            e->lockedMods,
+            e->baseGroup,
+            e->latchedGroup,
+            e->lockedGroup);
+
+    /* a layout switch changes the keysyms, modifiers alone don't */
+    if (xkb_state_serialize_layout(g_xkb_state, XKB_STATE_LAYOUT_EFFECTIVE) == layout)
+        return;
+
+    xkb_keysym_t previous[KEYCODES];
+    memcpy(previous, keysyms, sizeof(keysyms));
+    update_keysyms();
+    regrab_keys(previous, lock_mask);
+}
+
+void
+keyboard_update_keymap(int32_t device_id)
+{
+    if (device_id != device)
+        return;
+
+    struct xkb_keymap *new_keymap = xkb_x11_keymap_new_from_device(
+            context,
+            g_xcb,
+            device,
+            XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (! new_keymap) {
+        ERROR("can't compile the new keymap.");
+        return;
+    }
+
+    struct xkb_state *new_state = xkb_x11_state_new_from_device(
+            new_keymap,
+            g_xcb,
+            device);
+    if (! new_state) {
+        ERROR("can't get the new keyboard state.");
+        xkb_keymap_unref(new_keymap);
+        return;
+    }
+
+    xkb_state_unref(g_xkb_state);
+    xkb_keymap_unref(keymap);
+    keymap = new_keymap;
+    g_xkb_state = new_state;
+
+    xkb_keysym_t previous[KEYCODES];
+    unsigned int previous_lock_mask = lock_mask;
+    memcpy(previous, keysyms, sizeof(keysyms));
+    update_keysyms();
+    update_lock_mask();
+    regrab_keys(previous, previous_lock_mask);
+}
+
+Key *
+keyboard_lookup(unsigned int modifier, xkb_keycode_t keycode)
+{
+    if (keycode >= KEYCODES || keysyms[keycode] == XKB_KEY_NoSymbol)
+        return NULL;
+
+    Key *k = probe(clean(modifier), keysyms[keycode]);
+
+    return (k->shortcut || k->binding) ? k : NULL;
+}
+
+void
+keyboard_cleanup()
+{
+    xcb_ungrab_key(g_xcb, XCB_GRAB_ANY, g_root, XCB_MOD_MASK_ANY);
+    xcb_ungrab_button(g_xcb, XCB_BUTTON_INDEX_ANY, g_root, XCB_MOD_MASK_ANY);
+    free(keys);
+    keys = NULL;
+    size = 0;
+    xkb_state_unref(g_xkb_state);
+    xkb_keymap_unref(keymap);
+    xkb_context_unref(context);
+}
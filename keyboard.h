@@ -0,0 +1,22 @@
+#ifndef __KEYBOARD_H__
+#define __KEYBOARD_H__
+
+#include <xcb/xkb.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include "settings.h"
+
+/* a shortcut and/or a binding sharing the same key sequence */
+typedef struct _Key {
+    KeySequence     sequence;
+    Shortcut        *shortcut;
+    Binding         *binding;
+} Key;
+
+void keyboard_setup();
+void keyboard_update_state(xcb_xkb_state_notify_event_t *e);
+void keyboard_update_keymap(int32_t device_id);
+Key *keyboard_lookup(unsigned int modifier, xkb_keycode_t keycode);
+void keyboard_cleanup();
+
+#endif
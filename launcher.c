@@ -0,0 +1,182 @@
+/* for POSIX_SPAWN_SETSID */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "launcher.h"
+#include "log.h"
+#include "settings.h"
+#include "timer.h"
+#include "x11.h"
+
+extern char **environ;
+
+static char *resolve(const char *name);
+static char **path_of(Binding *binding);
+
+static posix_spawnattr_t    attributes;
+static LauncherStats        stats;
+static char                 **paths = NULL;
+static int                  bindings = 0;
+
+/*
+ * find the executable the way execvp would.
+ * the returned string should be freed.
+ */
+char *
+resolve(const char *name)
+{
+    char candidate[PATH_MAX];
+    const char *p, *q;
+
+    if (strchr(name, '/'))
+        return strdup(name);
+
+    p = getenv("PATH");
+    if (! p)
+        p = "/bin:/usr/bin";
+
+    for (; p; p = *q ? q + 1 : NULL) {
+        q = strchr(p, ':');
+        if (! q)
+            q = p + strlen(p);
+
+        /* an empty entry stands for the current directory */
+        if (q == p)
+            snprintf(candidate, sizeof(candidate), "./%s", name);
+        else
+            snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)(q - p), p, name);
+
+        if (access(candidate, X_OK) == 0)
+            return strdup(candidate);
+    }
+
+    return NULL;
+}
+
+/* resolved executables are cached per binding, the bar binding
+ * takes the last slot */
+char **
+path_of(Binding *binding)
+{
+    for (int i = 0; i < bindings; ++i)
+        if (binding == &g_bindings[i])
+            return &paths[i];
+
+    return &paths[bindings];
+}
+
+void
+launcher_setup()
+{
+    sigset_t defaults, mask;
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+
+    /* children must not inherit the x connection */
+    int fd = xcb_get_file_descriptor(g_xcb);
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+
+    /* nor the signals ignored by the window manager */
+    sigemptyset(&mask);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGCHLD);
+    sigaddset(&defaults, SIGTSTP);
+    sigaddset(&defaults, SIGTTOU);
+    sigaddset(&defaults, SIGTTIN);
+    sigaddset(&defaults, SIGHUP);
+    sigaddset(&defaults, SIGPIPE);
+
+    /* out of the window manager session, or at least its group */
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#else
+    flags |= POSIX_SPAWN_SETPGROUP;
+#endif
+
+    while (g_bindings[bindings].args[0] != NULL)
+        bindings++;
+    paths = calloc(bindings + 1, sizeof(char *));
+    if (! paths)
+        FATAL("can't allocate the launcher cache.");
+
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, flags);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setsigmask(&attributes, &mask);
+}
+
+/* posix_spawn does not copy the window manager address space the way
+ * fork does, it is cheap whatever the size of our mappings */
+pid_t
+launcher_exec(const char *path, char **argv)
+{
+    pid_t pid;
+    struct timespec start;
+
+    timer_now(&start);
+    int error = posix_spawn(&pid, path, NULL, &attributes, argv, environ);
+    long elapsed = timer_elapsed(&start);
+
+    if (error) {
+        stats.failures++;
+        ERROR("can't launch %s: %s", path, strerror(error));
+        return -1;
+    }
+
+    stats.launches++;
+    stats.total_us += elapsed;
+    if (elapsed > stats.max_us)
+        stats.max_us = elapsed;
+
+    return pid;
+}
+
+pid_t
+launcher_run(Binding *binding)
+{
+    char **path = path_of(binding);
+
+    /* resolve the executable once per binding */
+    if (! *path)
+        *path = resolve(binding->args[0]);
+
+    if (! *path) {
+        stats.failures++;
+        ERROR("can't find %s.", binding->args[0]);
+        return -1;
+    }
+
+    pid_t pid = launcher_exec(*path, binding->args);
+
+    /* the executable may have moved, look for it again next time */
+    if (pid < 0) {
+        free(*path);
+        *path = NULL;
+    }
+
+    return pid;
+}
+
+const LauncherStats *
+launcher_stats()
+{
+    return &stats;
+}
+
+void
+launcher_cleanup()
+{
+    for (int i = 0; paths && i <= bindings; ++i)
+        free(paths[i]);
+    free(paths);
+    paths = NULL;
+
+    posix_spawnattr_destroy(&attributes);
+}
@@ -0,0 +1,21 @@
+#ifndef __LAUNCHER_H__
+#define __LAUNCHER_H__
+
+#include <sys/types.h>
+
+#include "settings.h"
+
+typedef struct _LauncherStats {
+    long    launches;
+    long    failures;
+    long    total_us;
+    long    max_us;
+} LauncherStats;
+
+void launcher_setup();
+pid_t launcher_run(Binding *binding);
+pid_t launcher_exec(const char *path, char **argv);
+const LauncherStats *launcher_stats();
+void launcher_cleanup();
+
+#endif
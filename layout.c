@@ -0,0 +1,289 @@
+#include <stdlib.h>
+
+#include "layout.h"
+#include "log.h"
+
+typedef void (*LayoutFunction)(const LayoutRequest *r, Rectangle *tiles);
+
+static void split(
+        int mains, int stacked,
+        Rectangle main, Rectangle stack,
+        int horizontal,
+        Rectangle *tiles);
+static void none(const LayoutRequest *r, Rectangle *tiles);
+static void top(const LayoutRequest *r, Rectangle *tiles);
+static void left(const LayoutRequest *r, Rectangle *tiles);
+static void bottom(const LayoutRequest *r, Rectangle *tiles);
+static void right(const LayoutRequest *r, Rectangle *tiles);
+static void grid(const LayoutRequest *r, Rectangle *tiles);
+static void columns(const LayoutRequest *r, Rectangle *tiles);
+static void spiral(const LayoutRequest *r, Rectangle *tiles);
+
+static LayoutStats stats;
+
+static const LayoutFunction layouts[LT_COUNT] = {
+    [LT_NONE]       = none,
+    [LT_TOP]        = top,
+    [LT_LEFT]       = left,
+    [LT_BOTTOM]     = bottom,
+    [LT_RIGHT]      = right,
+    [LT_GRID]       = grid,
+    [LT_COLUMNS]    = columns,
+    [LT_SPIRAL]     = spiral,
+};
+
+/*
+ * the mains side by side in the main area, the stacked ones dividing the
+ * stack area, the first of them gets the remaining pixels.
+ * horizontal: mains go left to right and the stack top to bottom,
+ * the other way around otherwise.
+ */
+void
+split(
+        int mains, int stacked,
+        Rectangle main, Rectangle stack,
+        int horizontal,
+        Rectangle *tiles)
+{
+    int t = 0;
+
+    for (int i = 0; i < mains; ++i, ++t) {
+        tiles[t] = main;
+        if (horizontal)
+            main.x += main.width;
+        else
+            main.y += main.height;
+    }
+
+    if (! stacked)
+        return;
+
+    int size = horizontal ? stack.height / stacked : stack.width / stacked;
+    int remainder = (horizontal ? stack.height : stack.width) - stacked * size;
+
+    for (int i = 0; i < stacked; ++i, ++t) {
+        int s = size + (i ? 0 : remainder);
+        if (horizontal) {
+            tiles[t] = (Rectangle) {stack.x, stack.y, stack.width, s};
+            stack.y += s;
+        } else {
+            tiles[t] = (Rectangle) {stack.x, stack.y, s, stack.height};
+            stack.x += s;
+        }
+    }
+}
+
+void
+none(const LayoutRequest *r, Rectangle *tiles)
+{
+    for (int i = 0; i < r->count; ++i)
+        tiles[i] = r->area;
+}
+
+void
+right(const LayoutRequest *r, Rectangle *tiles)
+{
+    const Rectangle *a = &r->area;
+    int stacked = r->count - r->mains;
+    int main_w = stacked ? (a->width * r->split) / r->mains : a->width / r->mains;
+    int stack_w = a->width - main_w * r->mains;
+
+    split(r->mains, stacked,
+            (Rectangle) {a->x, a->y, main_w, a->height},
+            (Rectangle) {a->x + main_w * r->mains, a->y, stack_w, a->height},
+            1, tiles);
+}
+
+void
+left(const LayoutRequest *r, Rectangle *tiles)
+{
+    const Rectangle *a = &r->area;
+    int stacked = r->count - r->mains;
+    int main_w = stacked ? (a->width * r->split) / r->mains : a->width / r->mains;
+    int stack_w = a->width - main_w * r->mains;
+
+    split(r->mains, stacked,
+            (Rectangle) {a->x + stack_w, a->y, main_w, a->height},
+            (Rectangle) {a->x, a->y, stack_w, a->height},
+            1, tiles);
+}
+
+void
+bottom(const LayoutRequest *r, Rectangle *tiles)
+{
+    const Rectangle *a = &r->area;
+    int stacked = r->count - r->mains;
+    int main_h = stacked ? (a->height * r->split) / r->mains : a->height / r->mains;
+    int stack_h = a->height - main_h * r->mains;
+
+    split(r->mains, stacked,
+            (Rectangle) {a->x, a->y, a->width, main_h},
+            (Rectangle) {a->x, a->y + main_h * r->mains, a->width, stack_h},
+            0, tiles);
+}
+
+void
+top(const LayoutRequest *r, Rectangle *tiles)
+{
+    const Rectangle *a = &r->area;
+    int stacked = r->count - r->mains;
+    int main_h = stacked ? (a->height * r->split) / r->mains : a->height / r->mains;
+    int stack_h = a->height - main_h * r->mains;
+
+    split(r->mains, stacked,
+            (Rectangle) {a->x, a->y + stack_h, a->width, main_h},
+            (Rectangle) {a->x, a->y, a->width, stack_h},
+            0, tiles);
+}
+
+/* as many columns as rows or one more, the last row is stretched */
+void
+grid(const LayoutRequest *r, Rectangle *tiles)
+{
+    const Rectangle *a = &r->area;
+    int cols = 1;
+    while (cols * cols < r->count)
+        cols++;
+    int rows = (r->count + cols - 1) / cols;
+    int t = 0;
+
+    for (int row = 0; row < rows; ++row) {
+        int n = row < rows - 1 ? cols : r->count - cols * (rows - 1);
+        int y = a->y + row * a->height / rows;
+        int h = a->y + (row + 1) * a->height / rows - y;
+
+        for (int col = 0; col < n; ++col, ++t) {
+            int x = a->x + col * a->width / n;
+            int w = a->x + (col + 1) * a->width / n - x;
+            tiles[t] = (Rectangle) {x, y, w, h};
+        }
+    }
+}
+
+/* columns of equal width, the pixels left over are spread */
+void
+columns(const LayoutRequest *r, Rectangle *tiles)
+{
+    const Rectangle *a = &r->area;
+
+    for (int i = 0; i < r->count; ++i) {
+        int x = a->x + i * a->width / r->count;
+        int w = a->x + (i + 1) * a->width / r->count - x;
+        tiles[i] = (Rectangle) {x, a->y, w, a->height};
+    }
+}
+
+/* each tile takes half of what is left, turning clockwise */
+void
+spiral(const LayoutRequest *r, Rectangle *tiles)
+{
+    Rectangle rest = r->area;
+
+    for (int i = 0; i < r->count; ++i) {
+        if (i == r->count - 1) {
+            tiles[i] = rest;
+            break;
+        }
+
+        Rectangle t = rest;
+        switch (i % 4) {
+            case 0: /* left half */
+                t.width = rest.width / 2;
+                rest.x += t.width;
+                rest.width -= t.width;
+                break;
+            case 1: /* top half */
+                t.height = rest.height / 2;
+                rest.y += t.height;
+                rest.height -= t.height;
+                break;
+            case 2: /* right half */
+                t.width = rest.width / 2;
+                t.x = rest.x + rest.width - t.width;
+                rest.width -= t.width;
+                break;
+            case 3: /* bottom half */
+                t.height = rest.height / 2;
+                t.y = rest.y + rest.height - t.height;
+                rest.height -= t.height;
+                break;
+        }
+        tiles[i] = t;
+    }
+}
+
+void
+layout_apply(Layout layout, const LayoutRequest *request, Rectangle *tiles)
+{
+    LayoutRequest r = *request;
+
+    if (r.count <= 0)
+        return;
+
+    /* at least one main view and no more than there are tiles */
+    if (r.mains < 1)
+        r.mains = 1;
+    if (r.mains > r.count)
+        r.mains = r.count;
+
+    if (layout < 0 || layout >= LT_COUNT)
+        layout = LT_NONE;
+
+    layouts[layout](&r, tiles);
+}
+
+/* the tiles for the request, computed again only when one of its
+ * parameters differs from the previous one */
+const Rectangle *
+layout_cached(LayoutCache *cache, Layout layout, const LayoutRequest *request)
+{
+    if (cache->valid &&
+            cache->layout == layout &&
+            cache->request.area.x == request->area.x &&
+            cache->request.area.y == request->area.y &&
+            cache->request.area.width == request->area.width &&
+            cache->request.area.height == request->area.height &&
+            cache->request.count == request->count &&
+            cache->request.mains == request->mains &&
+            cache->request.split == request->split) {
+        stats.hits++;
+        return cache->tiles;
+    }
+
+    stats.misses++;
+
+    if (request->count > cache->size) {
+        cache->size = request->count * 2;
+        cache->tiles = realloc(cache->tiles, cache->size * sizeof(Rectangle));
+        if (! cache->tiles)
+            FATAL("can't allocate the tiles.");
+    }
+
+    layout_apply(layout, request, cache->tiles);
+    cache->valid = 1;
+    cache->layout = layout;
+    cache->request = *request;
+
+    return cache->tiles;
+}
+
+void
+layout_invalidate(LayoutCache *cache)
+{
+    cache->valid = 0;
+}
+
+void
+layout_release(LayoutCache *cache)
+{
+    free(cache->tiles);
+    cache->tiles = NULL;
+    cache->size = 0;
+    cache->valid = 0;
+}
+
+const LayoutStats *
+layout_stats()
+{
+    return &stats;
+}
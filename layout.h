@@ -0,0 +1,54 @@
+#ifndef __LAYOUT_H__
+#define __LAYOUT_H__
+
+#include "rectangle.h"
+
+/* bounds of the share of the mains */
+#define MAIN_SPLIT_MIN .2
+#define MAIN_SPLIT_MAX .8
+
+typedef enum _Layout {
+    LT_NONE,
+    LT_TOP,
+    LT_LEFT,
+    LT_BOTTOM,
+    LT_RIGHT,
+    LT_GRID,
+    LT_COLUMNS,
+    LT_SPIRAL,
+    LT_COUNT
+} Layout;
+
+/* what a layout is asked to tile */
+typedef struct _LayoutRequest {
+    Rectangle   area;   /* work area */
+    int         count;  /* tiles, in list order */
+    int         mains;  /* main views among them */
+    float       split;  /* share of the mains */
+} LayoutRequest;
+
+/* the last tiles computed for a monitor */
+typedef struct _LayoutCache {
+    int             valid;
+    Layout          layout;
+    LayoutRequest   request;
+    Rectangle       *tiles;
+    int             size;
+} LayoutCache;
+
+typedef struct _LayoutStats {
+    long    hits;
+    long    misses;
+} LayoutStats;
+
+/*
+ * layouts only compute rectangles, one per tile, borders included.
+ * they don't touch the clients nor talk to the server.
+ */
+void layout_apply(Layout layout, const LayoutRequest *request, Rectangle *tiles);
+const Rectangle *layout_cached(LayoutCache *cache, Layout layout, const LayoutRequest *request);
+void layout_invalidate(LayoutCache *cache);
+void layout_release(LayoutCache *cache);
+const LayoutStats *layout_stats();
+
+#endif
@@ -10,232 +10,135 @@
 #include "mosaic.h"
 #include "settings.h"
 #include "client.h"
+#include "stack.h"
+#include "timer.h"
 
 #define DEFAULT_LAYOUT LT_RIGHT
 #define DEFAULT_MAINS 1
-
-static void apply_none_layout(
-        Monitor *m,
-        int w_x,
-        int w_y,
-        int w_w,
-        int w_h);
-static void horizontal_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int main_x, int main_y, int main_w, int main_h,
-        int stack_x, int stack_y, int stack_w, int stack_h, int stack_r);
-static void apply_right_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h);
-static void apply_left_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h);
-static void vertical_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int main_x, int main_y, int main_w, int main_h,
-        int stack_x, int stack_y, int stack_w, int stack_h, int stack_r);
-static void apply_bottom_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h);
-static void apply_top_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h);
+#define DEFAULT_REFRESH 60
+
+/* what a client accounts for in its monitor counters */
+#define COUNTED_TILED       0x01
+#define COUNTED_FULLSCREEN  0x02
+#define COUNTED_FOCUSABLE   0x04
+#define COUNTED_STRUT       0x08
+#define COUNTED_VISIBLE     0x10
+
+static void render(Monitor *monitor, GeometryStatus status);
+static void reserve(Monitor *monitor);
+static void renumber(Monitor *monitor, int from, int to);
+static void tag(Monitor *monitor, Client *client);
+static void untag(Monitor *monitor, Client *client);
+static void render_fullscreen(Monitor *monitor);
+static void unlink_recent(Monitor *monitor, Client *client);
+static int can_focus(Client *client);
+
+static RenderStats stats;
 
 void
-apply_none_layout(Monitor *m, int w_x, int w_y, int w_w, int w_h)
+monitor_initialize(Monitor *monitor, const char *name, int x, int y, int width, int height)
 {
-    Client *c;
-    for (c = m->head; c; c = c->next)
-        if (c->mode == MODE_TILED && c->tagset & m->tagset)
-            client_set_tiling(c, &(Rectangle) { w_x, w_y, w_w, w_h });
+    strncpy(monitor->name, name, 127);
+    monitor->geometry = (Rectangle) { x, y, width, height };
+    monitor->refresh = DEFAULT_REFRESH;
+    monitor->layout = DEFAULT_LAYOUT;
+    monitor->split = g_split;
+    monitor->mains = DEFAULT_MAINS;
+    memset(monitor->tags, 0, 32 * sizeof(int));
+    memset(monitor->tagged, 0, 32 * sizeof(Client **));
+    memset(monitor->tagged_size, 0, 32 * sizeof(int));
+    monitor->tagset = 1;
+    monitor->tiled = 0;
+    monitor->fullscreens = 0;
+    monitor->focusables = 0;
+    monitor->parked = 0;
+    monitor->fullscreen = NULL;
+    monitor->reserved = (Strut) {0};
+    monitor->layout_cache = (LayoutCache) {0};
+    monitor->recent = NULL;
+    memset(monitor->recent_by_tag, 0, 32 * sizeof(Client *));
+    monitor->stack = NULL;
+    monitor->nstack = 0;
+    monitor->stack_size = 0;
+    monitor->clients = NULL;
+    monitor->counted = NULL;
+    monitor->nclients = 0;
+    monitor->clients_size = 0;
+    monitor->next = NULL;
+    monitor->prev = NULL;
 }
 
 void
-horizontal_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int main_x, int main_y, int main_w, int main_h,
-        int stack_x, int stack_y, int stack_w, int stack_h, int stack_r)
+monitor_release(Monitor *monitor)
 {
-    int tiled = 0;
-
-    /* tile the main views */
-    Client *c;
-    for (c = m->head; c && tiled < mains; c = c->next) {
-        if (c->mode == MODE_TILED && client_is_visible(c)) {
-            client_set_tiling(c, &(Rectangle) {main_x, main_y, main_w, main_h});
-            main_x += main_w;
-            tiled++;
-        }
-    }
-
-    /* tile the stack */
-    tiled = 0;
-    for (; c && tiled < stacked; c = c->next) {
-        if (c->mode == MODE_TILED && client_is_visible(c)) {
-            client_set_tiling(c, &(Rectangle) {stack_x, stack_y, stack_w, (stack_h + stack_r)});
-            stack_y += stack_h + stack_r;
-            stack_r = 0;
-            tiled++;
-       }
+    layout_release(&monitor->layout_cache);
+    stack_release(monitor);
+    free(monitor->clients);
+    free(monitor->counted);
+    for (int i = 0; i < 32; ++i) {
+        free(monitor->tagged[i]);
+        monitor->tagged[i] = NULL;
+        monitor->tagged_size[i] = monitor->tags[i] = 0;
     }
+    monitor->clients = NULL;
+    monitor->counted = NULL;
+    monitor->nclients = monitor->clients_size = 0;
 }
 
+/* room for one more client */
 void
-apply_right_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h)
+reserve(Monitor *monitor)
 {
-    /* compute sizes */
-    int main_w = stacked ? (w_w * m->split) / mains : (w_w / mains);
-    int main_h = w_h;
-    int stack_w = w_w - main_w * mains;
-    int stack_h = stacked ? w_h / stacked : w_h;
-    int stack_r = w_h - stacked * stack_h;
-
-    /* compute positions */
-    int main_x = w_x;
-    int main_y = w_y;
-    int stack_x = w_x + main_w * mains;
-    int stack_y = w_y;
-
-    horizontal_layout(
-            m,
-            mains, stacked,
-            main_x, main_y, main_w, main_h,
-            stack_x, stack_y, stack_w, stack_h, stack_r);
+    if (monitor->nclients < monitor->clients_size)
+        return;
+
+    monitor->clients_size = monitor->clients_size ? monitor->clients_size * 2 : 16;
+    monitor->clients = realloc(monitor->clients, monitor->clients_size * sizeof(Client *));
+    monitor->counted = realloc(monitor->counted, monitor->clients_size);
+    if (! monitor->clients || ! monitor->counted)
+        FATAL("can't allocate the monitor clients.");
 }
 
+/* the clients between the two slots moved */
 void
-apply_left_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h)
+renumber(Monitor *monitor, int from, int to)
 {
-    /* compute sizes */
-    int main_w = stacked ? (w_w * m->split) / mains : (w_w / mains);
-    int main_h = w_h;
-    int stack_w = w_w - main_w * mains;
-    int stack_h = stacked ? w_h / stacked : w_h;
-    int stack_r = w_h - stacked * stack_h;
-
-    /* compute positions */
-    int main_x = w_x + stack_w;
-    int main_y = w_y;
-    int stack_x = w_x;
-    int stack_y = w_y;
-
-    horizontal_layout(
-            m,
-            mains, stacked,
-            main_x, main_y, main_w, main_h,
-            stack_x, stack_y, stack_w, stack_h, stack_r);
+    for (int i = from; i <= to && i < monitor->nclients; ++i)
+        monitor->clients[i]->slot = i;
 }
 
+/* the client joins the index of each of its tags */
 void
-vertical_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int main_x, int main_y, int main_w, int main_h,
-        int stack_x, int stack_y, int stack_w, int stack_h, int stack_r)
+tag(Monitor *monitor, Client *client)
 {
-    int tiled = 0;
-
-    /* tile the main views */
-    Client *c;
-    for (c = m->head; c && tiled < mains; c = c->next) {
-        if (c->mode == MODE_TILED && client_is_visible(c)) {
-            client_set_tiling(c, &(Rectangle) {main_x, main_y, main_w, main_h});
-            main_y += main_h;
-            tiled++;
-        }
-    }
+    for (int i = 0; i < 32; ++i) {
+        if (! (client->tagset & (1L << i)))
+            continue;
 
-    /* tile the stack */
-    tiled = 0;
-    for (; c && tiled < stacked; c = c->next) {
-        if (c->mode == MODE_TILED && client_is_visible(c)) {
-            client_set_tiling(c, &(Rectangle) {stack_x, stack_y, stack_w, (stack_h + stack_r)});
-            stack_x += stack_w + stack_r;
-            stack_r = 0;
-            tiled++;
-       }
+        if (monitor->tags[i] == monitor->tagged_size[i]) {
+            monitor->tagged_size[i] = monitor->tagged_size[i] ? monitor->tagged_size[i] * 2 : 16;
+            monitor->tagged[i] = realloc(monitor->tagged[i], monitor->tagged_size[i] * sizeof(Client *));
+            if (! monitor->tagged[i])
+                FATAL("can't allocate the monitor tags.");
+        }
+        monitor->tagged[i][monitor->tags[i]++] = client;
     }
 }
 
 void
-apply_bottom_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h)
+untag(Monitor *monitor, Client *client)
 {
-    /* compute sizes */
-    int main_w = w_w;
-    int main_h = stacked ? (w_h * m->split) / mains : (w_h / mains);
-    int stack_h = w_h - main_h * mains;
-    int stack_w = stacked ? w_w / stacked : w_w;
-    int stack_r = w_w - stacked * stack_w;
-
-    /* compute positions */
-    int main_x = w_x;
-    int main_y = w_y;
-    int stack_x = w_x;
-    int stack_y = w_y + main_h * mains;
-
-    vertical_layout(
-            m,
-            mains, stacked,
-            main_x, main_y, main_w, main_h,
-            stack_x, stack_y, stack_w, stack_h, stack_r);
-}
-
-void
-apply_top_layout(
-        Monitor *m,
-        int mains, int stacked,
-        int w_x, int w_y, int w_w, int w_h)
-{
-    /* compute sizes */
-    int main_w = w_w;
-    int main_h = stacked ? (w_h * m->split) / mains : (w_h / mains);
-    int stack_h = w_h- main_h * mains;
-    int stack_w = stacked ? w_w / stacked : w_w;
-    int stack_r = w_w - stacked * stack_w;
-
-    /* compute positions */
-    int main_x = w_x;
-    int main_y = w_y + stack_h;
-    int stack_x = w_x;
-    int stack_y = w_y;
-
-    vertical_layout(
-            m,
-            mains, stacked,
-            main_x, main_y, main_w, main_h,
-            stack_x, stack_y, stack_w, stack_h, stack_r);
-}
+    for (int i = 0; i < 32; ++i) {
+        if (! (client->tagset & (1L << i)))
+            continue;
 
-void
-monitor_initialize(Monitor *monitor, const char *name, int x, int y, int width, int height)
-{
-    strncpy(monitor->name, name, 127);
-    monitor->geometry = (Rectangle) { x, y, width, height };
-    monitor->layout = DEFAULT_LAYOUT;
-    monitor->split = g_split;
-    monitor->mains = DEFAULT_MAINS;
-    memset(monitor->tags, 0, 32 * sizeof(int));
-    monitor->tagset = 1;
-    monitor->head = NULL;
-    monitor->tail = NULL;
-    monitor->next = NULL;
-    monitor->prev = NULL;
+        for (int j = 0; j < monitor->tags[i]; ++j) {
+            if (monitor->tagged[i][j] == client) {
+                monitor->tagged[i][j] = monitor->tagged[i][--monitor->tags[i]];
+                break;
+            }
+        }
+    }
 }
 
 void
@@ -244,20 +147,26 @@ monitor_attach(Monitor *monitor, Client *client)
     client->monitor = monitor;
     if (client->tagset < 0)
         client->tagset = monitor->tagset;
-    for (int i = 0; i < 32; ++i)
-        if (client->tagset & (1L << i))
-            monitor->tags[i]++;
-
-    if (monitor->head) {
-        client->next = monitor->head;
-        monitor->head->prev = client;
-    }
-
-    if (! monitor->tail)
-        monitor->tail = client;
-
-    monitor->head = client;
-    client->prev = NULL;
+    tag(monitor, client);
+
+    /* first in tiling order, counted as nothing yet */
+    reserve(monitor);
+    memmove(&monitor->clients[1], &monitor->clients[0],
+            monitor->nclients * sizeof(Client *));
+    memmove(&monitor->counted[1], &monitor->counted[0], monitor->nclients);
+    monitor->clients[0] = client;
+    monitor->counted[0] = 0;
+    monitor->nclients++;
+    renumber(monitor, 0, monitor->nclients - 1);
+    stack_attach(monitor, client);
+
+    /* it is about to be focused, or it would not be worth it */
+    client->info->older = monitor->recent;
+    client->info->newer = NULL;
+    if (monitor->recent)
+        monitor->recent->info->newer = client;
+    monitor->recent = client;
+    client_update_visibility(client);
 
     /* default policy for floatings other than fixed
      * is to be centered on the monitor */
@@ -275,39 +184,267 @@ monitor_detach(Monitor *monitor, Client *client)
     if (client->monitor != monitor)
         return;
 
-    /* remove the client from this monitor */
-    if (client->prev)
-        client->prev->next = client->next;
-    else
-        monitor->head = client->next;
+    untag(monitor, client);
+    stack_detach(monitor, client);
+    unlink_recent(monitor, client);
+    for (int i = 0; i < 32; ++i)
+        if (monitor->recent_by_tag[i] == client)
+            monitor->recent_by_tag[i] = NULL;
+
+    /* no longer counted, then out of the arrays */
+    client->monitor = NULL;
+    monitor_update_client(monitor, client);
+    client_update_visibility(client);
+
+    int slot = client->slot;
+    monitor->nclients--;
+    memmove(&monitor->clients[slot], &monitor->clients[slot + 1],
+            (monitor->nclients - slot) * sizeof(Client *));
+    memmove(&monitor->counted[slot], &monitor->counted[slot + 1],
+            monitor->nclients - slot);
+    renumber(monitor, slot, monitor->nclients - 1);
+    client->slot = -1;
+}
 
-    if (client->next)
-        client->next->prev = client->prev;
-    else
-        monitor->tail = client->prev;
+/* exchange the places of two clients in the tiling order and their tiles */
+void
+monitor_swap(Monitor *monitor, Client *a, Client *b)
+{
+    if (a == b || a->monitor != monitor || b->monitor != monitor)
+        return;
+
+    int sa = a->slot, sb = b->slot;
+    unsigned char counted = monitor->counted[sa];
+
+    monitor->clients[sa] = b;
+    monitor->clients[sb] = a;
+    monitor->counted[sa] = monitor->counted[sb];
+    monitor->counted[sb] = counted;
+    a->slot = sb;
+    b->slot = sa;
+
+    Rectangle r = a->tiling_geometry;
+    a->tiling_geometry = b->tiling_geometry;
+    b->tiling_geometry = r;
+}
+
+/* move the client to this place in the tiling order */
+void
+monitor_move(Monitor *monitor, Client *client, int slot)
+{
+    int from = client->slot;
+
+    if (client->monitor != monitor || slot < 0 || slot >= monitor->nclients || slot == from)
+        return;
+
+    unsigned char counted = monitor->counted[from];
+    if (slot < from) {
+        memmove(&monitor->clients[slot + 1], &monitor->clients[slot],
+                (from - slot) * sizeof(Client *));
+        memmove(&monitor->counted[slot + 1], &monitor->counted[slot], from - slot);
+    } else {
+        memmove(&monitor->clients[from], &monitor->clients[from + 1],
+                (slot - from) * sizeof(Client *));
+        memmove(&monitor->counted[from], &monitor->counted[from + 1], slot - from);
+    }
+    monitor->clients[slot] = client;
+    monitor->counted[slot] = counted;
+    renumber(monitor, MIN(slot, from), MAX(slot, from));
+}
+
+void
+unlink_recent(Monitor *monitor, Client *client)
+{
+    if (client->info->newer)
+        client->info->newer->info->older = client->info->older;
+    else if (monitor->recent == client)
+        monitor->recent = client->info->older;
+
+    if (client->info->older)
+        client->info->older->info->newer = client->info->newer;
+
+    client->info->newer = NULL;
+    client->info->older = NULL;
+}
+
+int
+can_focus(Client *client)
+{
+    return client_is_visible(client) &&
+        (client->state & STATE_ACCEPT_FOCUS) == STATE_ACCEPT_FOCUS;
+}
+
+/* the client goes first in the focus history, and of each of its tags */
+void
+monitor_focus(Monitor *monitor, Client *client)
+{
+    if (client->monitor != monitor)
+        return;
 
     for (int i = 0; i < 32; ++i)
         if (client->tagset & (1L << i))
-            monitor->tags[i]--;
+            monitor->recent_by_tag[i] = client;
 
-    client->monitor = NULL;
-    client->next = NULL;
+    if (monitor->recent == client)
+        return;
+
+    unlink_recent(monitor, client);
+    client->info->older = monitor->recent;
+    if (monitor->recent)
+        monitor->recent->info->newer = client;
+    monitor->recent = client;
 }
 
+/*
+ * the client that should get the focus back, if any. when a single tag
+ * is shown, the last one focused on it answers at once. otherwise the
+ * clients are looked at from the most recently focused, so the walk
+ * stops early but may cover the whole list.
+ */
+Client *
+monitor_recent(Monitor *monitor)
+{
+    if (! monitor->focusables)
+        return NULL;
+
+    for (int i = 0; i < 32; ++i) {
+        if (monitor->tagset == (1L << i)) {
+            Client *c = monitor->recent_by_tag[i];
+            if (c && can_focus(c))
+                return c;
+            break;
+        }
+    }
+
+    for (Client *c = monitor->recent; c; c = c->info->older)
+        if (can_focus(c))
+            return c;
+
+    return NULL;
+}
+
+/*
+ * show other tags. only the clients of the tags shown or hidden by the
+ * change are looked at, those leaving the view are hidden at once and
+ * the next render places those entering it.
+ */
 void
-monitor_update_main_views(Monitor *monitor, int by)
+monitor_set_tagset(Monitor *monitor, int tagset)
 {
-    if (by > 0) {
+    int changed = monitor->tagset ^ tagset;
+
+    monitor->tagset = tagset;
+    for (int i = 0; i < 32; ++i)
+        if (changed & (1L << i))
+            for (int j = 0; j < monitor->tags[i]; ++j)
+                client_update_visibility(monitor->tagged[i][j]);
+}
+
+/* change the tags of a client of the monitor, its visibility is left
+ * to the caller */
+void
+monitor_retag(Monitor *monitor, Client *client, int tagset)
+{
+    if (! monitor || client->monitor != monitor) {
+        client->tagset = tagset;
+        return;
+    }
 
-        int tilables = 0;
-        for (Client *c = monitor->head; c; c = c->next)
-            if (c->mode == MODE_TILED && client_is_visible(c))
-                tilables++;
+    untag(monitor, client);
+    client->tagset = tagset;
+    tag(monitor, client);
+}
 
-        if (tilables >= monitor->mains + by)
+/*
+ * account for the client in the monitor counters, to be called whenever
+ * its monitor, visibility, mode, focus or strut changes. calling it
+ * again without change does nothing.
+ */
+void
+monitor_update_client(Monitor *monitor, Client *client)
+{
+    int counted = 0;
+
+    if (client->monitor == monitor && client_is_visible(client)) {
+        counted |= COUNTED_VISIBLE;
+        if (client->mode == MODE_TILED)
+            counted |= COUNTED_TILED;
+        if (client->mode == MODE_FULLSCREEN)
+            counted |= COUNTED_FULLSCREEN;
+        if ((client->state & STATE_ACCEPT_FOCUS) == STATE_ACCEPT_FOCUS)
+            counted |= COUNTED_FOCUSABLE;
+        if ((client->state & STATE_STRUT) == STATE_STRUT)
+            counted |= COUNTED_STRUT;
+    }
+
+    /* not in the arrays anymore, or not yet */
+    int slot = client->slot;
+    if (slot < 0 || slot >= monitor->nclients || monitor->clients[slot] != client)
+        return;
+
+    int changed = counted ^ monitor->counted[slot];
+    monitor->counted[slot] = counted;
+
+    if (changed & COUNTED_TILED)
+        monitor->tiled += counted & COUNTED_TILED ? 1 : -1;
+    if (changed & COUNTED_FULLSCREEN) {
+        if (counted & COUNTED_FULLSCREEN) {
+            monitor->fullscreens++;
+            client->info->next_fullscreen = monitor->fullscreen;
+            monitor->fullscreen = client;
+        } else {
+            monitor->fullscreens--;
+            Client **p = &monitor->fullscreen;
+            while (*p && *p != client)
+                p = &(*p)->info->next_fullscreen;
+            if (*p)
+                *p = client->info->next_fullscreen;
+            client->info->next_fullscreen = NULL;
+        }
+    }
+    if (changed & COUNTED_FOCUSABLE)
+        monitor->focusables += counted & COUNTED_FOCUSABLE ? 1 : -1;
+    if (changed & COUNTED_STRUT)
+        monitor_update_struts(monitor);
+
+    /* the renders only look at the clients in view, and only at the
+     * fullscreen ones once the monitor is parked. the others are hidden
+     * as they come */
+    if (client->monitor == monitor &&
+            (! (counted & COUNTED_VISIBLE) ||
+             (monitor->parked && ! (counted & COUNTED_FULLSCREEN))))
+        client_hide(client);
+}
+
+/* the space reserved is the largest strut on each side, only the
+ * clients with a strut are looked at */
+void
+monitor_update_struts(Monitor *monitor)
+{
+    monitor->reserved = (Strut) {0};
+    layout_invalidate(&monitor->layout_cache);
+
+    /* XXX: the client position should be considered
+     * especially if there's several client reserving space */
+    for (int i = 0; i < monitor->nclients; ++i) {
+        if (! (monitor->counted[i] & COUNTED_STRUT))
+            continue;
+        Client *c = monitor->clients[i];
+        monitor->reserved.left = MAX(monitor->reserved.left, c->info->strut.left);
+        monitor->reserved.right = MAX(monitor->reserved.right, c->info->strut.right);
+        monitor->reserved.top = MAX(monitor->reserved.top, c->info->strut.top);
+        monitor->reserved.bottom = MAX(monitor->reserved.bottom, c->info->strut.bottom);
+    }
+}
+
+void
+monitor_update_main_views(Monitor *monitor, int by)
+{
+    if (by > 0) {
+        if (monitor->tiled >= monitor->mains + by)
             monitor->mains += by;
         else
-            monitor->mains = tilables;
+            monitor->mains = monitor->tiled;
     } else {
         if (monitor->mains + by > 1)
             monitor->mains += by;
@@ -319,90 +456,128 @@ monitor_update_main_views(Monitor *monitor, int by)
 void
 monitor_render(Monitor *monitor, GeometryStatus status)
 {
-    int tilables = 0;
-    int fullscreen = 0;
-    int rr = 0, rl = 0, rt = 0, rb = 0, wx = 0, wy = 0, ww = 0, wh = 0;
+    struct timespec start;
+    long elapsed;
 
-    if (bar_is_monitor(monitor) && bar_is_opened())
-        rt = g_bar_height;
+    timer_now(&start);
+    if (monitor->fullscreens) {
+        render_fullscreen(monitor);
+        stats.fullscreens++;
+    } else {
+        render(monitor, status);
+    }
+    elapsed = timer_elapsed(&start);
+
+    stats.renders++;
+    stats.total_us += elapsed;
+    if (elapsed > stats.max_us)
+        stats.max_us = elapsed;
+}
+
+const RenderStats *
+monitor_render_stats()
+{
+    return &stats;
+}
+
+/*
+ * a fullscreen client owns the monitor: the others are parked off
+ * screen the first time, then only the fullscreen clients are looked
+ * at, see monitor_update_client. no tiles nor transients are computed
+ * and the bar of the monitor is not redrawn meanwhile.
+ */
+void
+render_fullscreen(Monitor *monitor)
+{
+    if (! monitor->parked) {
+        for (int i = 0; i < monitor->nclients; ++i, stats.clients++)
+            if (! (monitor->counted[i] & COUNTED_FULLSCREEN))
+                client_hide(monitor->clients[i]);
+        monitor->parked = 1;
+    }
 
-    /* first round to get information about clients. */
-    for (Client *c = monitor->head; c; c = c->next) {
-        if (c->mode == MODE_FULLSCREEN)
-            fullscreen++;
+    for (Client *c = monitor->fullscreen; c; c = c->info->next_fullscreen, stats.clients++)
+        client_show(c);
 
-        if ((c->state & STATE_STICKY) != STATE_STICKY || ! status)
-            client_hide(c);
+    stack_apply(monitor);
+}
 
-        if (c->mode == MODE_TILED && client_is_visible(c))
-            tilables++;
+void
+render(Monitor *monitor, GeometryStatus status)
+{
+    int tilables = monitor->tiled;
+    int rr = 0, rl = 0, rt = 0, rb = 0, wx = 0, wy = 0, ww = 0, wh = 0;
 
-        /* XXX: the client position should be considered
-         * especially if there's several client reserving space */
-        if (client_is_visible(c)) {
-            rl = MAX(rl, c->strut.left);
-            rr = MAX(rr, c->strut.right);
-            rt = MAX(rt, c->strut.top);
-            rb = MAX(rb, c->strut.bottom);
+    /* back from fullscreen, the bar missed the updates and the sticky
+     * clients, skipped below unless the geometry changed, were parked */
+    if (monitor->parked) {
+        for (int i = 0; i < monitor->nclients; ++i) {
+            Client *c = monitor->clients[i];
+            if ((monitor->counted[i] & COUNTED_VISIBLE) &&
+                    (c->state & STATE_STICKY) == STATE_STICKY)
+                client_show(c);
+        }
+        monitor->parked = 0;
+        if (bar_is_monitor(monitor) && bar_is_opened()) {
+            refresh_wmstatus();
+            bar_display_systatus();
         }
     }
+
+    if (bar_is_monitor(monitor) && bar_is_opened())
+        rt = g_bar_height;
+
+    rl = monitor->reserved.left;
+    rr = monitor->reserved.right;
+    rt = MAX(rt, monitor->reserved.top);
+    rb = monitor->reserved.bottom;
+
     wx = monitor->geometry.x + rl;
     wy = monitor->geometry.y + rt;
     ww = monitor->geometry.width - (rl + rr);
     wh = monitor->geometry.height - (rt + rb);
 
-    int mains = tilables < monitor->mains ? tilables : monitor->mains;
-    int stacked = (tilables - mains) > 0 ? (tilables - mains ) : 0;
-
-#if 0
-#ifndef NDEBUG
-    DEBUG("rendering: %s - (%d, %d), [%d x %d]", monitor->name, wx, wy, ww, wh);
-    DEBUG("\ttilables: %d", tilables);
-    DEBUG("\tmains: %d", mains);
-    DEBUG("\tstacked: %d", stacked);
-    DEBUG("\tfullscreen: %d", fullscreen);
-    DEBUG("\thead: %p", monitor->head);
-    DEBUG("\ttail: %p", monitor->tail);
-    for (Client *c = monitor->head; c; c = c->next)
-        DEBUG("\tclient: %p", c);
-#endif
-#endif
     /* compute tiles positions */
-    if (tilables && !fullscreen) {
-        switch(monitor->layout) {
-            case LT_RIGHT:
-                apply_right_layout(monitor, mains, stacked, wx, wy, ww, wh);
-                break;
-            case LT_LEFT:
-                apply_left_layout(monitor, mains, stacked, wx, wy, ww, wh);
-                break;
-            case LT_BOTTOM:
-                apply_bottom_layout(monitor, mains, stacked, wx, wy, ww, wh);
-                break;
-            case LT_TOP:
-                apply_top_layout(monitor, mains, stacked, wx, wy, ww, wh);
-                break;
-            default:
-                apply_none_layout(monitor, wx, wy, ww, wh);
-                break;
-        }
+    if (tilables) {
+        LayoutRequest request = {
+            { wx, wy, ww, wh },
+            tilables,
+            monitor->mains,
+            monitor->split };
+        const Rectangle *tiles = layout_cached(
+                &monitor->layout_cache,
+                monitor->layout,
+                &request);
+
+        int t = 0;
+        for (int i = 0; i < monitor->nclients && t < tilables; ++i)
+            if (monitor->counted[i] & COUNTED_TILED)
+                client_set_tiling(monitor->clients[i], &tiles[t++]);
     }
 
-    /* display clients */
-    for (Client *c = monitor->head; c; c = c->next) {
-        /* if we have some fullscreen, display only those */
-        if (fullscreen && (c->mode != MODE_FULLSCREEN))
+    /* display the clients in view, those out of it were hidden when
+     * they left, see monitor_update_client. only those whose place
+     * changed are sent to the server */
+    for (int i = 0; i < monitor->nclients; ++i) {
+        if (! (monitor->counted[i] & COUNTED_VISIBLE))
             continue;
 
-        if (client_is_visible(c) && ! c->transient &&
-                (((c->state & STATE_STICKY) != STATE_STICKY) || ! status))
+        Client *c = monitor->clients[i];
+        stats.clients++;
+        if ((c->state & STATE_STICKY) == STATE_STICKY && status)
+            continue;
+
+        if (! c->transient)
             client_show(c);
     }
 
-
     /* last round for the transients for.
      * only now we know where they belong. */
-    for (Client *c = monitor->head; c; c = c->next) {
+    for (int i = 0; i < monitor->nclients; ++i) {
+        if (! (monitor->counted[i] & COUNTED_VISIBLE))
+            continue;
+
+        Client *c = monitor->clients[i];
         if (c->transient) {
             Client *t = lookup(c->transient);
             if (t) {
@@ -412,9 +587,11 @@ monitor_render(Monitor *monitor, GeometryStatus status)
                     c->floating_geometry.width / 2;
                 c->floating_geometry.y = (r.y + r.height / 2) -
                     c->floating_geometry.height / 2;
-                client_show(c);
             }
+            client_show(c);
         }
     }
+
+    stack_apply(monitor);
 }
 
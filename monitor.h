@@ -1,19 +1,11 @@
 #ifndef __MONITOR_H__
 #define __MONITOR_H__
 
+#include "client.h"
+#include "layout.h"
 #include "rectangle.h"
-
-typedef struct _Client Client;
 typedef struct _Bar Bar;
 
-typedef enum _Layout {
-    LT_NONE,
-    LT_TOP,
-    LT_LEFT,
-    LT_BOTTOM,
-    LT_RIGHT
-} Layout;
-
 typedef enum _GeometryStatus {
     GS_CHANGED,
     GS_UNCHANGED
@@ -22,21 +14,57 @@ typedef enum _GeometryStatus {
 typedef struct _Monitor {
     char                name[128];
     Rectangle           geometry;
+    int                 refresh;    /* Hz */
     Layout              layout;
     float               split;
     int                 mains;
-    int                 tags[32];
+    int                 tags[32];   /* clients by tag */
+    Client              **tagged[32];   /* those clients, in no order */
+    int                 tagged_size[32];
     int                 tagset;
-    Client              *head;
-    Client              *tail;
+    int                 tiled;      /* visible clients by kind */
+    int                 fullscreens;
+    int                 focusables;
+    int                 parked;     /* the others hidden for a fullscreen */
+    Client              *fullscreen;    /* the fullscreen clients counted */
+    Strut               reserved;   /* by the visible struts */
+    LayoutCache         layout_cache;
+    Client              *recent;    /* most recently focused first */
+    Client              *recent_by_tag[32];
+    struct _Client      **stack;    /* bottom to top, see stack.c */
+    int                 nstack;
+    int                 stack_size;
+    Client              **clients;  /* in tiling order */
+    unsigned char       *counted;   /* what each one is counted as */
+    int                 nclients;
+    int                 clients_size;
     struct _Monitor     *next;
     struct _Monitor     *prev;
 } Monitor;
 
+/* time spent laying out and configuring the clients */
+typedef struct _RenderStats {
+    long    renders;
+    long    clients;        /* counted by the loops rendering them */
+    long    fullscreens;    /* reduced to the fullscreen clients */
+    long    total_us;
+    long    max_us;
+} RenderStats;
+
 void monitor_initialize(Monitor *monitor, const char *name, int x, int y, int width, int height);
+void monitor_release(Monitor *monitor);
 void monitor_attach(Monitor *monitor, Client *client);
 void monitor_detach(Monitor *monitor, Client *client);
+void monitor_swap(Monitor *monitor, Client *a, Client *b);
+void monitor_move(Monitor *monitor, Client *client, int slot);
+void monitor_focus(Monitor *monitor, Client *client);
+Client *monitor_recent(Monitor *monitor);
+void monitor_set_tagset(Monitor *monitor, int tagset);
+void monitor_retag(Monitor *monitor, Client *client, int tagset);
+void monitor_update_client(Monitor *monitor, Client *client);
+void monitor_update_struts(Monitor *monitor);
 void monitor_update_main_views(Monitor *monitor, int by);
 void monitor_render(Monitor *monitor, GeometryStatus status);
+const RenderStats *monitor_render_stats();
 
 #endif
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <poll.h>
 #include <string.h>
 #include <unistd.h>
@@ -9,14 +10,26 @@
 #include <sys/select.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "mosaic.h"
 #include "log.h"
 #include "monitor.h"
 #include "client.h"
+#include "bench.h"
+#include "drag.h"
 #include "hints.h"
+#include "intern.h"
 #include "events.h"
+#include "keyboard.h"
+#include "launcher.h"
+#include "pool.h"
+#include "rules.h"
 #include "settings.h"
+#include "slab.h"
+#include "stack.h"
+#include "sync.h"
+#include "timer.h"
 #include "bar.h"
 #include "x11.h"
 
@@ -30,10 +43,39 @@ static void usage();
 static void version();
 static unsigned int parse_color(const char* hex);
 static void swap(Client *c1, Client *c2);
+static void resolve_names(xcb_atom_t *atoms, int count);
+static void scan_refresh_rates(const Rectangle *geometries, int *rates, int count);
+static void mark_changed(Monitor **changed, int *nchanged, Monitor *m);
+static const char *name_of(xcb_atom_t atom);
+static Monitor *find_monitor(const char *name);
+static void timeline(const char *step);
+static void child(int sig);
+static void reap();
+static void autostart();
+
+#define MAX_MONITORS 16
+#define MAX_MONITOR_NAMES 32
+#define MAX_CRTCS 32
+
+typedef struct _MonitorName {
+    xcb_atom_t  atom;
+    char        name[128];
+} MonitorName;
 
 static xcb_window_t supporting_window = XCB_NONE;
-static struct xkb_context *xkb_context = NULL;
-static struct xkb_keymap *xkb_keymap = NULL;
+static MonitorName monitor_names[MAX_MONITOR_NAMES];
+static int monitor_names_count = 0;
+
+static Slab client_slab = SLAB(Client);
+static Slab client_info_slab = SLAB(ClientInfo);
+static Slab monitor_slab = SLAB(Monitor);
+
+/* time from a map request to the MapNotify of the window */
+static struct {
+    long    maps;
+    long    total_us;
+    long    max_us;
+} map_stats;
 
 static Monitor *monitor_head = NULL;
 static Monitor *monitor_tail = NULL;
@@ -47,12 +89,16 @@ static xcb_atom_t wm_delete_window_atom;
 */
 
 static int running;
+static int signal_pipe[2] = { -1, -1 };
+static pid_t autostart_pid = -1;
+static struct timespec startup;
 
 void
 setup()
 {
     /* connect to x11 */
     x11_setup();
+    timeline("X connected");
 
     /* check if a window manager is already running */
     xcb_void_cookie_t checkwm = xcb_change_window_attributes_checked(
@@ -132,7 +178,7 @@ setup()
             g_root,
             g_ewmh._NET_SUPPORTED,
             XCB_ATOM_ATOM, 32,
-            9, (xcb_atom_t[]) {
+            12, (xcb_atom_t[]) {
                 g_ewmh._NET_ACTIVE_WINDOW,
                 g_ewmh._NET_SUPPORTED,
                 g_ewmh._NET_WM_NAME,
@@ -141,52 +187,16 @@ setup()
                 g_ewmh._NET_WM_STATE_FULLSCREEN,
                 g_ewmh._NET_WM_WINDOW_TYPE,
                 g_ewmh._NET_WM_WINDOW_TYPE_DIALOG,
-                g_ewmh._NET_CLIENT_LIST
+                g_ewmh._NET_CLIENT_LIST,
+                g_ewmh._NET_WM_SYNC_REQUEST,
+                g_ewmh._NET_WM_SYNC_REQUEST_COUNTER,
+                g_atoms[NET_WM_BYPASS_COMPOSITOR]
             });
 
-    /* setting up keyboard and listen changes */
-    /* TODO: setup a handler. */
-    unsigned char xkb_base_event;
-    xkb_x11_setup_xkb_extension(
-            g_xcb,
-            XKB_X11_MIN_MAJOR_XKB_VERSION,
-            XKB_X11_MIN_MINOR_XKB_VERSION,
-            0,
-            NULL,
-            NULL,
-            &xkb_base_event,
-            NULL);
-    xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-    int device = xkb_x11_get_core_keyboard_device_id(g_xcb);
-    xkb_keymap = xkb_x11_keymap_new_from_device(
-            xkb_context,
-            g_xcb,
-            device,
-            XKB_KEYMAP_COMPILE_NO_FLAGS);
-    g_xkb_state = xkb_x11_state_new_from_device(
-            xkb_keymap,
-            g_xcb,
-            device);
-    int map = XCB_XKB_EVENT_TYPE_STATE_NOTIFY |
-              XCB_XKB_EVENT_TYPE_MAP_NOTIFY |
-              XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY;
-    int parts = XCB_XKB_MAP_PART_KEY_TYPES |
-                XCB_XKB_MAP_PART_KEY_SYMS |
-                XCB_XKB_MAP_PART_MODIFIER_MAP |
-                XCB_XKB_MAP_PART_EXPLICIT_COMPONENTS |
-                XCB_XKB_MAP_PART_KEY_ACTIONS |
-                XCB_XKB_MAP_PART_KEY_BEHAVIORS |
-                XCB_XKB_MAP_PART_VIRTUAL_MODS |
-                XCB_XKB_MAP_PART_VIRTUAL_MOD_MAP;
-    xcb_xkb_select_events(
-            g_xcb,
-            XCB_XKB_ID_USE_CORE_KBD,
-            map,
-            0,
-            map,
-            parts,
-            parts,
-            0);
+    /* setup the rules, shortcuts and bindings */
+    rules_setup();
+    keyboard_setup();
+    launcher_setup();
 
     /* listen for input changes */
     xcb_randr_select_input(
@@ -196,6 +206,7 @@ setup()
             XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE |
             XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
             XCB_RANDR_NOTIFY_MASK_OUTPUT_PROPERTY);
+    events_setup();
 
     /* manage existing windows */
     xcb_query_tree_reply_t *tree = xcb_query_tree_reply(
@@ -230,47 +241,7 @@ setup()
         free(ac);
         free(tree);
     }
-
-    /* setup shortcuts and bindings */
-    xcb_ungrab_key(g_xcb, XCB_GRAB_ANY, g_root, XCB_MOD_MASK_ANY);
-    xcb_key_symbols_t *ks = xcb_key_symbols_alloc(g_xcb);
-
-    int i = 0;
-    while (g_shortcuts[i].callback.vcb != NULL) {
-        xcb_keycode_t *kcs;
-        xcb_keycode_t *kc;
-
-        kcs = xcb_key_symbols_get_keycode(ks, g_shortcuts[i].sequence.keysym);
-        for (kc = kcs; kc && *kc != XCB_NO_SYMBOL; kc++)
-            xcb_grab_key(
-                    g_xcb,
-                    1,
-                    g_root,
-                    g_shortcuts[i].sequence.modifier,
-                    *kc,
-                    XCB_GRAB_MODE_ASYNC,
-                    XCB_GRAB_MODE_ASYNC);
-        i++;
-    }
-
-    i = 0;
-    while (g_bindings[i].args[0] != NULL) {
-        xcb_keycode_t *kcs;
-        xcb_keycode_t *kc;
-        kcs = xcb_key_symbols_get_keycode(ks, g_bindings[i].sequence.keysym);
-        for (kc = kcs; kc && *kc != XCB_NO_SYMBOL; kc++)
-            xcb_grab_key(
-                    g_xcb,
-                    1,
-                    g_root,
-                    g_bindings[i].sequence.modifier,
-                    *kc,
-                    XCB_GRAB_MODE_ASYNC,
-                    XCB_GRAB_MODE_ASYNC);
-        i++;
-    }
-
-    xcb_key_symbols_free(ks);
+    timeline("adoption done");
 }
 
 void
@@ -307,128 +278,162 @@ cleanup()
     xcb_aux_sync(g_xcb);
     xcb_grab_server(g_xcb);
 
-    Monitor *m, *n;
-    m = monitor_head;
-    n = NULL;
-    while (m) {
-        Client *c, *d;
-        n = m->next;
-
-        c = m->head;
-        d = NULL;
-        while (c) {
-            d = c->next;
-            free(c);
-            c = d;
-        }
-        free(m);
-        m = n;
-    }
+    for (Monitor *m = monitor_head; m; m = m->next)
+        monitor_release(m);
+    slab_destroy(&client_slab);
+    slab_destroy(&client_info_slab);
+    slab_destroy(&monitor_slab);
+    monitor_head = monitor_tail = NULL;
 
     /* destroy the supporting window */
     xcb_destroy_window(g_xcb, supporting_window);
     xcb_ungrab_server(g_xcb);
 
+    /* release the keyboard */
+    keyboard_cleanup();
+    pool_cleanup();
+    rules_cleanup();
+    intern_cleanup();
+    launcher_cleanup();
+    sync_cleanup();
+
     /* disconnect from x11 */
     x11_cleanup();
 }
 
+/* monitor names are atoms, resolve each of them once */
 void
-update_monitors(Monitor *scanned)
+resolve_names(xcb_atom_t *atoms, int count)
 {
-    for (Monitor *ms = scanned; ms; ms = ms->next)
-        for (Monitor *me = monitor_head; me; me = me->next)
-            if (strcmp(me->name, ms->name) == 0)
-                me = ms;
+    xcb_get_atom_name_cookie_t cookies[MAX_MONITORS];
+    int pending[MAX_MONITORS];
+    int npending = 0;
+
+    /* send all the requests first, then collect the replies */
+    for (int i = 0; i < count; ++i) {
+        if (name_of(atoms[i]))
+            continue;
+        cookies[npending] = xcb_get_atom_name(g_xcb, atoms[i]);
+        pending[npending++] = i;
+    }
+
+    for (int i = 0; i < npending; ++i) {
+        xcb_get_atom_name_reply_t *reply = xcb_get_atom_name_reply(
+                g_xcb,
+                cookies[i],
+                NULL);
+
+        MonitorName *n = &monitor_names[monitor_names_count % MAX_MONITOR_NAMES];
+        monitor_names_count++;
+        n->atom = atoms[pending[i]];
+
+        if (reply) {
+            int len = MIN(xcb_get_atom_name_name_length(reply), (int)sizeof(n->name) - 1);
+            strncpy(n->name, xcb_get_atom_name_name(reply), len);
+            n->name[len] = '\0';
+            free(reply);
+        } else {
+            snprintf(n->name, sizeof(n->name), "monitor-%u", n->atom);
+        }
+    }
 }
 
+/* the refresh rate of the crtc at the origin of each monitor, in Hz */
 void
-add_new_monitors(Monitor *scanned)
+scan_refresh_rates(const Rectangle *geometries, int *rates, int count)
 {
-    for (Monitor *ms = scanned; ms; ms = ms->next) {
+    xcb_randr_get_crtc_info_cookie_t cookies[MAX_CRTCS];
 
-        /* check if already exists */
-        int exists = 0;
-        for (Monitor *me = monitor_head; me; me = me->next) {
-            if (strcmp(me->name, ms->name) == 0) {
-                exists = 1;
+    for (int i = 0; i < count; ++i)
+        rates[i] = 0;
+
+    xcb_randr_get_screen_resources_current_reply_t *resources =
+        xcb_randr_get_screen_resources_current_reply(
+                g_xcb,
+                xcb_randr_get_screen_resources_current(g_xcb, g_root),
+                NULL);
+    if (! resources)
+        return;
+
+    xcb_randr_crtc_t *crtcs = xcb_randr_get_screen_resources_current_crtcs(resources);
+    int ncrtcs = MIN(xcb_randr_get_screen_resources_current_crtcs_length(resources), MAX_CRTCS);
+    for (int i = 0; i < ncrtcs; ++i)
+        cookies[i] = xcb_randr_get_crtc_info(g_xcb, crtcs[i], resources->config_timestamp);
+
+    for (int i = 0; i < ncrtcs; ++i) {
+        xcb_randr_get_crtc_info_reply_t *crtc = xcb_randr_get_crtc_info_reply(
+                g_xcb,
+                cookies[i],
+                NULL);
+        if (! crtc)
+            continue;
+
+        int rate = 0;
+        for (xcb_randr_mode_info_iterator_t iter =
+                xcb_randr_get_screen_resources_current_modes_iterator(resources);
+                iter.rem && crtc->mode;
+                xcb_randr_mode_info_next(&iter)) {
+            xcb_randr_mode_info_t *mode = iter.data;
+            if (mode->id == crtc->mode && mode->htotal && mode->vtotal) {
+                unsigned int total = mode->htotal * (unsigned int)mode->vtotal;
+                rate = (mode->dot_clock + total / 2) / total;
                 break;
             }
         }
 
-        if (exists)
-            continue;
+        /* mirrored crtcs share a monitor, the slowest one paces it */
+        for (int j = 0; j < count && rate; ++j)
+            if (geometries[j].x == crtc->x && geometries[j].y == crtc->y &&
+                    (! rates[j] || rate < rates[j]))
+                rates[j] = rate;
 
-        /* if not add it */
-        INFO("Adding monitor %s: (%d, %d), [%d, %d]",
-                ms->name,
-                ms->geometry.x,
-                ms->geometry.y,
-                ms->geometry.width,
-                ms->geometry.height);
-        Monitor *m = malloc(sizeof(Monitor));
-        monitor_initialize(
-                m,
-                ms->name,
-                ms->geometry.x,
-                ms->geometry.y,
-                ms->geometry.width,
-                ms->geometry.height);
-
-        add_monitor(m);
+        free(crtc);
     }
+
+    free(resources);
 }
 
-void
-del_old_monitors(Monitor *scanned)
+const char *
+name_of(xcb_atom_t atom)
 {
-    Monitor *m, *n;
-    m = monitor_head;
-    while (m) {
-         /* check if already exists */
-        int exists = 0;
-        for (Monitor *ms = scanned; ms; ms = ms->next) {
-            if (strcmp(m->name, ms->name) == 0) {
-                exists = 1;
-                break;
-            }
-        }
+    int count = MIN(monitor_names_count, MAX_MONITOR_NAMES);
+    for (int i = 0; i < count; ++i)
+        if (monitor_names[i].atom == atom)
+            return monitor_names[i].name;
 
-        if (exists) {
-            m = m->next;
-            continue;
-        }
+    return NULL;
+}
 
-        /* if not remove it */
-        INFO("Removing monitor %s: (%d, %d), [%d, %d]",
-                m->name,
-                m->geometry.x,
-                m->geometry.y,
-                m->geometry.width,
-                m->geometry.height);
-
-        Client *c, *d;
-        c = m->head;
-        while (c) {
-            d = c->next;
-            monitor_detach(m, c);
-            monitor_attach(primary_monitor, c);
-            c = d;
-        }
+Monitor *
+find_monitor(const char *name)
+{
+    for (Monitor *m = monitor_head; m; m = m->next)
+        if (strcmp(m->name, name) == 0)
+            return m;
 
-        n = m->next;
-        del_monitor(m);
-        free(m);
-        m = n;
-    }
+    return NULL;
 }
 
 void
-scan_monitors()
+mark_changed(Monitor **changed, int *nchanged, Monitor *m)
 {
-    Monitor *scanned = NULL;
+    for (int i = 0; i < *nchanged; ++i)
+        if (changed[i] == m)
+            return;
 
-    bar_close();
+    changed[(*nchanged)++] = m;
+}
+
+void
+scan_monitors()
+{
+    xcb_atom_t atoms[MAX_MONITORS];
+    Rectangle geometries[MAX_MONITORS];
+    int rates[MAX_MONITORS];
+    char names[MAX_MONITORS][128];
+    Monitor *changed[MAX_MONITORS];
+    int scanned = 0, nchanged = 0, primary = 0;
+    int reopen_bar = ! primary_monitor;
 
     /* build the list of detected monitors */
     xcb_randr_get_monitors_reply_t *monitors_reply;
@@ -437,109 +442,214 @@ scan_monitors()
             xcb_randr_get_monitors(g_xcb, g_root, 1),
             NULL);
 
-    char primary_name[128];
-    for (xcb_randr_monitor_info_iterator_t iter =
-            xcb_randr_get_monitors_monitors_iterator(monitors_reply);
-            iter.rem; xcb_randr_monitor_info_next(&iter)) {
-        const xcb_randr_monitor_info_t *monitor_info = iter.data;
-
-        xcb_get_atom_name_reply_t *name =
-                xcb_get_atom_name_reply(
-                        g_xcb,
-                        xcb_get_atom_name(g_xcb, monitor_info->name),
-                        NULL);
-        /* XXX: name = NULL !!! */
-        int len = xcb_get_atom_name_name_length(name);
-        char cname[128];
-        strncpy(cname, xcb_get_atom_name_name(name), len);
-        cname[len] = '\0';
-        Monitor *m = malloc(sizeof(Monitor));
-        monitor_initialize(
-                m,
-                cname,
-                monitor_info->x,
-                monitor_info->y,
-                monitor_info->width,
-                monitor_info->height);
-
-        /* add the monitor */
-        if (scanned) {
-            scanned->prev = m;
-            m->next = scanned;
+    if (monitors_reply) {
+        for (xcb_randr_monitor_info_iterator_t iter =
+                xcb_randr_get_monitors_monitors_iterator(monitors_reply);
+                iter.rem && scanned < MAX_MONITORS;
+                xcb_randr_monitor_info_next(&iter)) {
+            const xcb_randr_monitor_info_t *monitor_info = iter.data;
+
+            atoms[scanned] = monitor_info->name;
+            geometries[scanned] = (Rectangle) {
+                    monitor_info->x,
+                    monitor_info->y,
+                    monitor_info->width,
+                    monitor_info->height };
+
+            /* keep track of the primary */
+            if (monitor_info->primary)
+                primary = scanned;
+
+            scanned++;
         }
-        scanned = m;
-
-        /* keep track of the primary */
-        if (monitor_info->primary)
-            strcpy(primary_name, cname);
-    }
-    free(monitors_reply);
-
-    update_monitors(scanned);
-    add_new_monitors(scanned);
-    del_old_monitors(scanned);
-
-    /* free the scanned list */
-    Monitor *ms = scanned;
-    while (ms) {
-        Monitor *n = ms;
-        ms = ms->next;
-        free(n);
+        free(monitors_reply);
     }
 
-    /* find the primay */
-    for (Monitor *m = monitor_head; m; m = m->next) {
-        if (strcmp(m->name, primary_name) == 0)
-            primary_monitor = m;
-    }
+    resolve_names(atoms, scanned);
+    scan_refresh_rates(geometries, rates, scanned);
+    for (int i = 0; i < scanned; ++i)
+        snprintf(names[i], sizeof(names[i]), "%s", name_of(atoms[i]));
 
     /* if no monitor, fallback to root window */
-    if (! monitor_head) {
+    if (! scanned) {
         xcb_get_geometry_reply_t *reply =
                 xcb_get_geometry_reply(
                         g_xcb,
                         xcb_get_geometry(g_xcb, g_root),
                         NULL);
-        Monitor *m = malloc(sizeof(Monitor));
-        monitor_initialize(
-                m,
-                "Default",
-                reply->x,
-                reply->y,
-                reply->width,
-                reply->height);
-        /* add the monitor */
-        if (monitor_tail) {
-            m->prev = monitor_tail;
-            monitor_tail->next = m;
+        strcpy(names[0], "Default");
+        geometries[0] = reply ?
+            (Rectangle) { reply->x, reply->y, reply->width, reply->height } :
+            (Rectangle) { 0, 0, g_screen->width_in_pixels, g_screen->height_in_pixels };
+        rates[0] = 0;
+        scanned = 1;
+        free(reply);
+    }
+
+    /* add the new monitors and update the geometry of the known ones */
+    for (int i = 0; i < scanned; ++i) {
+        Monitor *m = find_monitor(names[i]);
+        Rectangle *g = &geometries[i];
+
+        if (! m) {
+            INFO("Adding monitor %s: (%d, %d), [%d, %d]",
+                    names[i], g->x, g->y, g->width, g->height);
+            m = slab_alloc(&monitor_slab);
+            monitor_initialize(m, names[i], g->x, g->y, g->width, g->height);
+            add_monitor(m);
+            changed[nchanged++] = m;
+        } else if (m->geometry.x != g->x || m->geometry.y != g->y ||
+                m->geometry.width != g->width || m->geometry.height != g->height) {
+            INFO("Updating monitor %s: (%d, %d), [%d, %d]",
+                    names[i], g->x, g->y, g->width, g->height);
+            m->geometry = *g;
+            layout_invalidate(&m->layout_cache);
+            changed[nchanged++] = m;
+            if (bar_is_monitor(m))
+                reopen_bar = 1;
         }
 
-        if (! monitor_head)
-            monitor_head = m;
+        if (rates[i])
+            m->refresh = rates[i];
+    }
 
-        monitor_tail = m;
-        free(reply);
+    /* find the primary, the bar leaves the previous one */
+    Monitor *p = find_monitor(names[primary]);
+    Monitor *previous = primary_monitor;
+    if (p != primary_monitor) {
+        primary_monitor = p;
+        reopen_bar = 1;
     }
 
-    /* set the primary */
-    if (!primary_monitor)
-        primary_monitor = monitor_head;
+    /* remove the old monitors, their clients go to the primary */
+    Monitor *m = monitor_head, *n;
+    while (m) {
+        n = m->next;
 
-    bar_open(primary_monitor);
+        int exists = 0;
+        for (int i = 0; i < scanned && ! exists; ++i)
+            exists = strcmp(m->name, names[i]) == 0;
+
+        if (! exists) {
+            INFO("Removing monitor %s: (%d, %d), [%d, %d]",
+                    m->name,
+                    m->geometry.x,
+                    m->geometry.y,
+                    m->geometry.width,
+                    m->geometry.height);
+
+            while (m->nclients) {
+                Client *c = m->clients[0];
+                monitor_detach(m, c);
+                monitor_attach(primary_monitor, c);
+            }
 
-    focused_client = NULL;
-    focused_monitor = primary_monitor;
+            if (m == focused_monitor)
+                focused_monitor = NULL;
 
-    hints_set_monitor(focused_monitor);
-    refresh_wmstatus();
+            /* the monitor may have been marked as changed */
+            for (int i = 0; i < nchanged; ++i)
+                if (changed[i] == m)
+                    changed[i--] = changed[--nchanged];
+            if (m == previous)
+                previous = NULL;
 
-    /* render the monitors with updated geometry */
-    for (Monitor *m = monitor_head; m; m = m->next)
-        monitor_render(m, GS_CHANGED);
+            mark_changed(changed, &nchanged, primary_monitor);
+
+            del_monitor(m);
+            monitor_release(m);
+            slab_free(&monitor_slab, m);
+        }
+        m = n;
+    }
+
+    if (reopen_bar) {
+        int opened = bar_is_opened();
+        bar_close();
+        bar_open(primary_monitor);
+        if (opened)
+            bar_show();
+
+        /* the space for the bar moves along */
+        layout_invalidate(&primary_monitor->layout_cache);
+        mark_changed(changed, &nchanged, primary_monitor);
+        if (previous && previous != primary_monitor) {
+            layout_invalidate(&previous->layout_cache);
+            mark_changed(changed, &nchanged, previous);
+        }
+    }
+
+    if (! focused_monitor) {
+        focused_monitor = primary_monitor;
+        hints_set_monitor(focused_monitor);
+    }
+
+    if (reopen_bar)
+        refresh_wmstatus();
+
+    /* render the monitors whose geometry or clients changed */
+    for (int i = 0; i < nchanged; ++i)
+        monitor_render(changed[i], GS_CHANGED);
 
     xcb_flush(g_xcb);
 }
 
+void
+timeline(const char *step)
+{
+    INFO("startup: %s (+%ld ms).", step, timer_elapsed(&startup) / 1000);
+}
+
+/* only wake up the main loop, children are reaped there */
+void
+child(int sig)
+{
+    (void)sig;
+    int saved = errno;
+    if (write(signal_pipe[1], "c", 1) < 0) {
+        /* the pipe is full, the loop is already woken up */
+    }
+    errno = saved;
+}
+
+void
+reap()
+{
+    char buffer[64];
+    pid_t pid;
+
+    while (read(signal_pipe[0], buffer, sizeof(buffer)) > 0);
+
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+        if (pid == autostart_pid) {
+            autostart_pid = -1;
+            timeline("autostart finished");
+        }
+        pool_reaped(pid);
+    }
+}
+
+void
+autostart()
+{
+    char *home = 0;
+    char path[1024];
+    struct stat st;
+
+    home = getenv("HOME");
+    if (! home)
+        return;
+
+    snprintf(path, sizeof(path), "%s/%s", home, AUTOSTART);
+    if (stat(path, &st) == 0 && st.st_mode & S_IXUSR) {
+        INFO("execute: %s.", path);
+        /* through a shell as system() did, it may lack a shebang */
+        autostart_pid = launcher_exec("/bin/sh", (char *[]) { "sh", path, NULL });
+    } else {
+        INFO("no mosaicrc found.");
+    }
+}
+
 void
 trap(int sig)
 {
@@ -559,7 +669,9 @@ usage()
            "--focused-color\tset window border color when focused (default blue).\n"
            "--urgent-color\tset window border color when urgent (default red).\n"
            "--bg-color\tset backgound color (default black).\n"
-           "--fg-color\tset foreground  color (default white).\n");
+           "--fg-color\tset foreground  color (default white).\n"
+           "--focus-delay\tms the pointer rests on a window before it is focused (default 0, at once).\n"
+           "--benchmark\ttime the renders of this many clients, on a spare server.\n");
     exit(2);
 }
 
@@ -601,16 +713,62 @@ dump()
     if (!f)
         return;
 
+    const LauncherStats *ls = launcher_stats();
+    fprintf(f, "Launcher: %ld launches, %ld failures, avg %ld us, max %ld us\n",
+            ls->launches,
+            ls->failures,
+            ls->launches ? ls->total_us / ls->launches : 0,
+            ls->max_us);
+
+    const RenderStats *rs = monitor_render_stats();
+    fprintf(f, "Render: %ld renders, %ld fullscreen, %ld clients, avg %ld us, max %ld us\n",
+            rs->renders,
+            rs->fullscreens,
+            rs->clients,
+            rs->renders ? rs->total_us / rs->renders : 0,
+            rs->max_us);
+
+    const LayoutStats *ts = layout_stats();
+    fprintf(f, "Layout cache: %ld hits, %ld misses\n", ts->hits, ts->misses);
+
+    const EnterStats *es = events_enter_stats();
+    fprintf(f, "Enter: %ld handled, %ld dropped, %ld discarded\n",
+            es->handled, es->dropped, es->discarded);
+
+    const DragStats *ds = drag_stats();
+    fprintf(f, "Drag: %ld drags, %ld motions, %ld updates\n",
+            ds->drags, ds->motions, ds->updates);
+
+    const SyncStats *ys = sync_stats();
+    fprintf(f, "Sync: %ld requests, %ld acks, %ld timeouts, %ld dropped\n",
+            ys->requests, ys->acks, ys->timeouts, ys->dropped);
+
+    const StackStats *ss = stack_stats();
+    fprintf(f, "Stacking: %ld restacks, %ld requests\n", ss->restacks, ss->requests);
+
+    fprintf(f, "Manage: %ld windows, avg %ld us to mapped, max %ld us\n",
+            map_stats.maps,
+            map_stats.maps ? map_stats.total_us / map_stats.maps : 0,
+            map_stats.max_us);
+
+    fprintf(f, "Slabs: clients %ld live, %ld peak, %ld pages; "
+            "monitors %ld live, %ld peak, %ld pages\n",
+            client_slab.live, client_slab.peak, client_slab.npages,
+            monitor_slab.live, monitor_slab.peak, monitor_slab.npages);
+
     fprintf(f, "Screen: [%d x %d]\n",
             g_screen->width_in_pixels,
             g_screen->height_in_pixels);
 
     for (Monitor *m = monitor_head; m; m = m->next) {
-        fprintf(f, "Monitor %s: (%d, %d) [%d, %d]\n",
+        fprintf(f, "Monitor %s: (%d, %d) [%d, %d] %d Hz, %d tiled, %d fullscreen, %d focusable\n",
                 m->name,
                 m->geometry.x, m->geometry.y,
-                m->geometry.width, m->geometry.height);
-        for (Client *c = m->head; c; c = c->next) {
+                m->geometry.width, m->geometry.height,
+                m->refresh,
+                m->tiled, m->fullscreens, m->focusables);
+        for (int i = 0; i < m->nclients; ++i) {
+            Client *c = m->clients[i];
             fprintf(f, "\t %p: %s, %d\n", c, (char*[]) {"tiled", "floating"}[c->mode - 1], c->state);
             fprintf(f, "\t\ttiled: (%d, %d) [%d, %d]\n",
                     c->tiling_geometry.x, c->tiling_geometry.y,
@@ -632,6 +790,7 @@ toggle_bar()
         bar_show();
         refresh_wmstatus();
     }
+    layout_invalidate(&primary_monitor->layout_cache);
     monitor_render(primary_monitor, GS_UNCHANGED);
     xcb_flush(g_xcb);
 }
@@ -642,7 +801,7 @@ refresh_wmstatus()
     if (! bar_is_opened())
         return;
 
-    char *cname = focused_client ? focused_client->instance : "None";
+    const char *cname = focused_client ? intern_string(focused_client->info->instance) : "None";
     int ctagset = focused_client ? focused_client->tagset : 0x0;
     bar_display_wmstatus(focused_monitor->tags, focused_monitor->tagset, cname, ctagset);
 }
@@ -650,25 +809,32 @@ refresh_wmstatus()
 void
 manage(xcb_window_t window)
 {
+    struct timespec start;
+    timer_now(&start);
+
     /* create the client */
-    Client *c = malloc(sizeof(Client));
+    Client *c = slab_alloc(&client_slab);
+    c->info = slab_alloc(&client_info_slab);
     client_initialize(c, window);
 
-    /* map it, attach it, focus it */
-    xcb_map_window(g_xcb, c->window);
+    /* attach it and lay it out first so the first frame is drawn at
+     * its final place, then map it and focus it */
+    Monitor *m = NULL;
     if (c->transient) {
         Client *t = lookup(c->transient);
-        if (t) {
-            monitor_attach(t->monitor, c);
-            monitor_render(t->monitor, GS_UNCHANGED);
-        }
+        if (t)
+            m = t->monitor;
     } else if ((c->state & STATE_STICKY) == STATE_STICKY) {
-        monitor_attach(primary_monitor, c);
-        monitor_render(primary_monitor, GS_UNCHANGED);
-    } else {
-        monitor_attach(focused_monitor, c);
-        monitor_render(focused_monitor, GS_UNCHANGED);
+        m = primary_monitor;
+    } else if (c->info->rule && c->info->rule->monitor) {
+        m = find_monitor(c->info->rule->monitor);
     }
+    if (! m)
+        m = focused_monitor;
+
+    monitor_attach(m, c);
+    monitor_render(m, GS_UNCHANGED);
+    xcb_map_window(g_xcb, c->window);
 
     client_set_input_focus(c);
 
@@ -680,7 +846,27 @@ manage(xcb_window_t window)
             XCB_ATOM_WINDOW, 32, 1, &window);
 
     xcb_flush(g_xcb);
-    xcb_aux_sync(g_xcb);
+
+    /* the clock stops once the server says the window is mapped */
+    c->info->map_start = start;
+    c->info->mapping = 1;
+}
+
+/* the server has mapped the window at its place */
+void
+mapped(xcb_window_t window)
+{
+    Client *c = lookup(window);
+
+    if (! c || ! c->info->mapping)
+        return;
+
+    c->info->mapping = 0;
+    long elapsed = timer_elapsed(&c->info->map_start);
+    map_stats.maps++;
+    map_stats.total_us += elapsed;
+    if (elapsed > map_stats.max_us)
+        map_stats.max_us = elapsed;
 }
 
 Client *
@@ -690,9 +876,9 @@ lookup(xcb_window_t window)
         return NULL;
 
     for (Monitor *m = monitor_head; m; m = m->next)
-        for (Client *c = m->head; c; c = c->next)
-            if (c->window == window)
-                return c;
+        for (int i = 0; i < m->nclients; ++i)
+            if (m->clients[i]->window == window)
+                return m->clients[i];
 
     return NULL;
 }
@@ -705,30 +891,31 @@ forget(xcb_window_t window)
     if (!c)
         return;
 
-    if (c == focused_client) {
-        Client *f = NULL;
-        if (c == c->monitor->head)
-            f = client_next(c, MODE_ANY, STATE_ACCEPT_FOCUS);
-        else
-           f = client_previous(c, MODE_ANY, STATE_ACCEPT_FOCUS);
+    Monitor *m = c->monitor;
+    drag_forget(c);
+    sync_detach(c);
+    monitor_detach(c->monitor, c);
+    monitor_render(m, GS_UNCHANGED);
 
+    /* give the focus back to the client focused before */
+    if (c == focused_client) {
+        focused_client = NULL;
+        Client *f = monitor_recent(m);
         if (f)
             client_set_input_focus(f);
     }
-    Monitor *m = c->monitor;
-    monitor_detach(c->monitor, c);
-    monitor_render(m, GS_UNCHANGED);
-    free(c);
+    slab_free(&client_info_slab, c->info);
+    slab_free(&client_slab, c);
 
     xcb_delete_property(g_xcb, g_root, g_ewmh._NET_CLIENT_LIST);
     for (Monitor *m = monitor_head; m; m = m->next)
-        for (Client *it = m->head; it; it = it->next)
+        for (int i = 0; i < m->nclients; ++i)
             xcb_change_property(
                     g_xcb,
                     XCB_PROP_MODE_APPEND,
                     g_root,
                     g_ewmh._NET_CLIENT_LIST,
-                    XCB_ATOM_WINDOW, 32, 1, &it->window);
+                    XCB_ATOM_WINDOW, 32, 1, &m->clients[i]->window);
 
     hints_set_monitor(focused_monitor);
     hints_set_focused(focused_client);
@@ -738,22 +925,11 @@ forget(xcb_window_t window)
 
 void
 find_focus(int fallback) {
-    int found = 0;
     focused_client = NULL;
-    Client *f = focused_monitor->head;
-    if (f) {
-        if (client_is_visible(f) && (f->state & STATE_ACCEPT_FOCUS) == STATE_ACCEPT_FOCUS) {
-            found = 1;
-            client_set_input_focus(f);
-        } else {
-            Client *nf = client_next(f, MODE_ANY, STATE_ACCEPT_FOCUS);
-            if (nf) {
-                found = 1;
-                client_set_input_focus(nf);
-            }
-        }
-    }
-    if (! found && fallback) {
+    Client *f = monitor_recent(focused_monitor);
+    if (f)
+        client_set_input_focus(f);
+    else if (fallback) {
         xcb_set_input_focus(
                 g_xcb,
                 XCB_INPUT_FOCUS_POINTER_ROOT,
@@ -772,6 +948,7 @@ focus(Client *client)
 {
     focused_client = client;
     focused_monitor = client->monitor;
+    monitor_focus(focused_monitor, client);
     client_receive_focus(client);
     hints_set_focused(focused_client);
     hints_set_monitor(focused_monitor);
@@ -817,6 +994,9 @@ focus_next_monitor()
 {
     if (focused_monitor->next) {
         focused_monitor = focused_monitor->next;
+        Client *c = monitor_recent(focused_monitor);
+        if (c)
+            client_set_input_focus(c);
         hints_set_monitor(focused_monitor);
         hints_set_focused(focused_client);
         refresh_wmstatus();
@@ -829,6 +1009,9 @@ focus_previous_monitor()
 {
     if (focused_monitor->prev) {
         focused_monitor = focused_monitor->prev;
+        Client *c = monitor_recent(focused_monitor);
+        if (c)
+            client_set_input_focus(c);
         hints_set_monitor(focused_monitor);
         hints_set_focused(focused_client);
         refresh_wmstatus();
@@ -872,25 +1055,21 @@ focused_monitor_set_layout(Layout layout)
 void
 focused_monitor_rotate_clockwise()
 {
-    if (! focused_monitor->tail)
+    int n = focused_monitor->nclients;
+    if (! n)
         return;
 
     /* find the last tilable */
-    Client *c = focused_monitor->tail->mode == MODE_TILED ?
-            focused_monitor->tail :
-            client_previous(focused_monitor->tail, MODE_TILED, STATE_ANY);
+    Client *tail = focused_monitor->clients[n - 1];
+    Client *c = tail->mode == MODE_TILED ?
+            tail :
+            client_previous(tail, MODE_TILED, STATE_ANY);
 
-    if (!c || c == focused_monitor->head)
+    if (!c || c->slot == 0)
         return;
 
     /* move it to the head */
-    if (c->prev) c->prev->next = c->next;
-    if (c->next) c->next->prev = c->prev;
-    if (! c->next) focused_monitor->tail = c->prev;
-    c->prev = NULL;
-    c->next = focused_monitor->head;
-    focused_monitor->head->prev = c;
-    focused_monitor->head = c;
+    monitor_move(focused_monitor, c, 0);
 
     monitor_render(focused_monitor, GS_UNCHANGED);
     xcb_flush(g_xcb);
@@ -899,25 +1078,21 @@ focused_monitor_rotate_clockwise()
 void
 focused_monitor_rotate_counter_clockwise()
 {
-    if (! focused_monitor->head)
+    int n = focused_monitor->nclients;
+    if (! n)
         return;
 
     /* find the first tilable */
-    Client *c = focused_monitor->head->mode == MODE_TILED ?
-            focused_monitor->head :
-            client_next(focused_monitor->head, MODE_TILED, STATE_ANY);
+    Client *head = focused_monitor->clients[0];
+    Client *c = head->mode == MODE_TILED ?
+            head :
+            client_next(head, MODE_TILED, STATE_ANY);
 
-    if (!c || c == focused_monitor->tail)
+    if (!c || c->slot == n - 1)
         return;
 
     /* move it to the tail */
-    if (c->prev) c->prev->next = c->next;
-    if (c->next) c->next->prev = c->prev;
-    if (! c->prev) focused_monitor->head = c->next;
-    c->next = NULL;
-    c->prev = focused_monitor->tail;
-    focused_monitor->tail->next = c;
-    focused_monitor->tail = c;
+    monitor_move(focused_monitor, c, n - 1);
 
     monitor_render(focused_monitor, GS_UNCHANGED);
     xcb_flush(g_xcb);
@@ -927,7 +1102,7 @@ focused_monitor_rotate_counter_clockwise()
 void
 focused_monitor_set_tag(int tag)
 {
-    focused_monitor->tagset = (1L << (tag - 1));
+    monitor_set_tagset(focused_monitor, 1L << (tag - 1));
 
     if (! focused_client || ! client_is_visible(focused_client))
         find_focus(1);
@@ -942,10 +1117,7 @@ focused_monitor_set_tag(int tag)
 void
 focused_monitor_toggle_tag(int tag)
 {
-    if (focused_monitor->tagset & (1L << (tag - 1)))
-        focused_monitor->tagset &= ~(1L << (tag - 1));
-    else
-        focused_monitor->tagset |= (1L << (tag - 1));
+    monitor_set_tagset(focused_monitor, focused_monitor->tagset ^ (1L << (tag - 1)));
 
     if (! focused_client || ! client_is_visible(focused_client))
         find_focus(1);
@@ -978,43 +1150,18 @@ focused_client_toggle_mode()
 
     focused_client->mode = focused_client->mode == MODE_FLOATING ?
             MODE_TILED : MODE_FLOATING;
+    monitor_update_client(focused_client->monitor, focused_client);
 
     monitor_render(focused_client->monitor, GS_UNCHANGED);
     xcb_flush(g_xcb);
 }
 
-/* we swap the content only and keep the list structure */
+/* the clients trade their places, the focus stays on the same client */
 void
 swap(Client *c1, Client *c2) {
-    Client t;
-
-#define COPY(c1 , c2)\
-    (c2)->window = (c1)->window;\
-    (c2)->mode = (c1)->mode;\
-    (c2)->saved_mode = (c1)->saved_mode;\
-    strncpy((c2)->instance, (c1)->instance, 255);\
-    strncpy((c2)->class, (c1)->class, 255);\
-    (c2)->border_width = (c1)->border_width;\
-    (c2)->border_color = (c1)->border_color;\
-    (c2)->state = (c1)->state;\
-    (c2)->strut = (c1)->strut;\
-    (c2)->size_hints = (c1)->size_hints;\
-    (c2)->transient = (c1)->transient;\
-    (c2)->monitor = (c1)->monitor;\
-    (c2)->tagset = (c1)->tagset;\
-    (c2)->saved_tagset = (c1)->saved_tagset;
-
-    COPY(c1, &t);
-    COPY(c2, c1);
-    COPY(&t, c2);
-
-#undef COPY
-
+    monitor_swap(c1->monitor, c1, c2);
     client_show(c1);
     client_show(c2);
-
-    /* swap the focus */
-    focused_client = c1 == focused_client ? c2 : c1;
 }
 
 #define MOVE_INC 35
@@ -1098,8 +1245,6 @@ focused_client_to_previous_monitor()
     }
 }
 
-#define MAIN_SPLIT_MIN .2
-#define MAIN_SPLIT_MAX .8
 #define MAIN_SPLIT_INC .05
 
 void
@@ -1141,13 +1286,8 @@ focused_client_set_tag(int tag)
     if (! focused_client || focused_client->mode ==  MODE_FULLSCREEN)
         return;
 
-    for (int i = 0; i < 32; ++i)
-        if (focused_client->tagset & (1L << i))
-            focused_monitor->tags[i]--;
-
-    focused_client->tagset = (1L << (tag - 1));
-    focused_client->tagset |= (1L << (tag - 1));
-    focused_monitor->tags[tag - 1]++;
+    monitor_retag(focused_client->monitor, focused_client, 1L << (tag - 1));
+    client_update_visibility(focused_client);
 
     if (! client_is_visible(focused_client))
         find_focus(1);
@@ -1167,14 +1307,14 @@ focused_client_toggle_tag(int tag)
     if (! focused_client || focused_client->mode ==  MODE_FULLSCREEN)
         return;
 
-    if (focused_client->tagset & (1L << (tag - 1))) {
-        focused_client->tagset &= ~(1L << (tag - 1));
-        if (! --focused_monitor->tags[tag - 1])
-            focused_monitor->tagset &= ~(1L << (tag - 1));
-    } else {
-        focused_client->tagset |= (1L << (tag - 1));
-        focused_monitor->tags[tag - 1]++;
-    }
+    monitor_retag(focused_client->monitor, focused_client,
+            focused_client->tagset ^ (1L << (tag - 1)));
+    client_update_visibility(focused_client);
+
+    /* a tag left empty is not shown anymore */
+    if (! focused_monitor->tags[tag - 1])
+        monitor_set_tagset(focused_monitor,
+                focused_monitor->tagset & ~(1L << (tag - 1)));
 
     if (focused_monitor->tags[tag - 1] == 0 ||
             focused_monitor->tagset & (1L << (tag - 1)))
@@ -1206,9 +1346,12 @@ main(int argc, char **argv)
         {"bar-fg-color",                required_argument,  0,  'j'},
         {"bar-selected-tag-bg-color",   required_argument,  0,  'k'},
         {"bar-selected-tag-fg-color",   required_argument,  0,  'l'},
+        {"focus-delay",                 required_argument,  0,  'm'},
+        {"benchmark",                   required_argument,  0,  'n'},
         {0, 0, 0, 0}};
-    int option_index = 0, opt;
+    int option_index = 0, opt, benchmark = 0;
 
+    timer_now(&startup);
     setlocale(LC_ALL, "");
 
     while ((opt = getopt_long_only(argc, argv, "abc:d:e:f:g:h:i:j:", long_options, &option_index)) != -1) {
@@ -1249,6 +1392,12 @@ main(int argc, char **argv)
             case 'l':
                 g_bar_selected_tag_fgcolor = parse_color(optarg);
                 break;
+            case 'm':
+                g_focus_delay = atoi(optarg);
+                break;
+            case 'n':
+                benchmark = atoi(optarg);
+                break;
             default:
                 usage();
         }
@@ -1256,8 +1405,25 @@ main(int argc, char **argv)
 
     setup();
 
+    /* render our own clients instead of managing the user ones */
+    if (benchmark > 0) {
+        bench_run(benchmark);
+        cleanup();
+        return 0;
+    }
+
     /* trap signals */
-    signal(SIGCHLD, SIG_IGN);
+    if (pipe(signal_pipe) < 0)
+        FATAL("can't create the signal pipe.");
+    for (int i = 0; i < 2; ++i) {
+        fcntl(signal_pipe[i], F_SETFL, fcntl(signal_pipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(signal_pipe[i], F_SETFD, fcntl(signal_pipe[i], F_GETFD) | FD_CLOEXEC);
+    }
+    struct sigaction sa;
+    sa.sa_handler = child;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
     signal(SIGTSTP, SIG_IGN);
     signal(SIGTTOU, SIG_IGN);
     signal(SIGTTIN, SIG_IGN);
@@ -1266,35 +1432,30 @@ main(int argc, char **argv)
     signal(SIGKILL, trap);
     signal(SIGTERM, trap);
 
-#ifdef NDEBUG
-    /* autostart */
-    char *home = 0;
-    char autostart[1024];
-    struct stat st;
-    autostart[0] = '\0';
-    home = getenv("HOME");
-    if (home) {
-        snprintf(autostart, sizeof(autostart), "%s/%s", home, AUTOSTART);
-        if (stat(autostart, &st) == 0 && st.st_mode & S_IXUSR) {
-            INFO("execute: %s.", autostart);
-            system(autostart);
-        } else {
-            INFO("no mosaicrc found.");
-        }
-    }
-#endif
+    /* warm up the pooled bindings */
+    pool_setup();
 
     /* listen for events */
     INFO("entering main loop.");
+    timeline("loop entered");
+
+#ifdef NDEBUG
+    /* the window manager is live, autostart can take its time */
+    autostart();
+#endif
+
+    struct pollfd fds[] = {
+        { xcb_get_file_descriptor(g_xcb), POLLIN, 0 },
+        { signal_pipe[0], POLLIN, 0 }
+    };
+
+    unsigned int fenced = g_layout_sequence;
     running = 1;
+    xcb_generic_event_t *queued = NULL;
     while (running) {
-        if (xcb_connection_has_error(g_xcb))
-            break;
-
         xcb_generic_event_t *event;
-        while ((event = xcb_wait_for_event(g_xcb))) {
-            if (! running)
-                break;
+        while (running && ((event = queued) || (event = xcb_poll_for_event(g_xcb)))) {
+            queued = NULL;
             if (event->response_type == 0) {
                 xcb_generic_error_t *e = (xcb_generic_error_t *)event;
                 /* ignore some events */
@@ -1318,6 +1479,31 @@ main(int argc, char **argv)
             free(event);
         }
 
+        if (! running || xcb_connection_has_error(g_xcb))
+            break;
+
+        /* the timers go once all the events are read, a drag frame
+         * works from the last pointer position */
+        timer_run();
+
+        /* the replies the timers waited for may have left events in the
+         * xcb queue, that poll() would not see */
+        queued = xcb_poll_for_queued_event(g_xcb);
+
+        /* the server stays at the last layout request until it gets
+         * another one, the enter events the user causes from now on
+         * must come with a later sequence */
+        if (fenced != g_layout_sequence) {
+            xcb_no_operation(g_xcb);
+            fenced = g_layout_sequence;
+        }
+
+        xcb_flush(g_xcb);
+        if (poll(fds, 2, queued ? 0 : timer_timeout()) < 0 && errno != EINTR)
+            break;
+
+        if (fds[1].revents & POLLIN)
+            reap();
     }
 
     bar_close();
@@ -33,6 +33,7 @@ void scan_monitors();
 
 /* windows */
 void manage(xcb_window_t window);
+void mapped(xcb_window_t window);
 Client * lookup(xcb_window_t window);
 void forget(xcb_window_t window);
 void find_focus(int fallback);
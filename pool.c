@@ -0,0 +1,177 @@
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_ewmh.h>
+
+#include "launcher.h"
+#include "log.h"
+#include "pool.h"
+#include "settings.h"
+#include "x11.h"
+
+#define POOL_MAX 8
+
+/*
+ * instances of a binding launched ahead of time.
+ * a process is pending until its window asks to be mapped, the window
+ * is then kept unmapped and out of the layouts until the binding is
+ * triggered.
+ */
+typedef struct _Pool {
+    Binding         *binding;
+    int             size;
+    pid_t           pending[POOL_MAX];
+    int             npending;
+    xcb_window_t    windows[POOL_MAX];
+    int             nwindows;
+    int             lost;       /* processes gone without a window in a row */
+} Pool;
+
+static void refill(Pool *pool);
+
+static Pool *pools = NULL;
+static int  npools = 0;
+static int  npending = 0;
+
+void
+refill(Pool *pool)
+{
+    while (pool->npending + pool->nwindows < pool->size) {
+        pid_t pid = launcher_run(pool->binding);
+        if (pid < 0)
+            return;
+        pool->pending[pool->npending++] = pid;
+        npending++;
+    }
+}
+
+void
+pool_setup()
+{
+    for (int i = 0; g_bindings[i].args[0] != NULL; ++i)
+        if (g_bindings[i].pool > 0)
+            npools++;
+
+    if (! npools)
+        return;
+
+    pools = calloc(npools, sizeof(Pool));
+    if (! pools)
+        FATAL("can't allocate the pools.");
+
+    Pool *p = pools;
+    for (int i = 0; g_bindings[i].args[0] != NULL; ++i) {
+        if (g_bindings[i].pool <= 0)
+            continue;
+
+        p->binding = &g_bindings[i];
+        p->size = g_bindings[i].pool < POOL_MAX ? g_bindings[i].pool : POOL_MAX;
+        refill(p++);
+    }
+}
+
+/* keep the window aside if it belongs to a pending process */
+int
+pool_adopt(xcb_window_t window)
+{
+    uint32_t pid;
+
+    if (! npending)
+        return 0;
+
+    if (! xcb_ewmh_get_wm_pid_reply(
+            &g_ewmh,
+            xcb_ewmh_get_wm_pid(&g_ewmh, window),
+            &pid,
+            NULL))
+        return 0;
+
+    for (Pool *p = pools; p < pools + npools; ++p) {
+        for (int i = 0; i < p->npending; ++i) {
+            if (p->pending[i] != (pid_t)pid)
+                continue;
+
+            p->pending[i] = p->pending[--p->npending];
+            npending--;
+            p->lost = 0;
+            p->windows[p->nwindows++] = window;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* return a warm window of the binding if any, and launch its replacement */
+xcb_window_t
+pool_take(Binding *binding)
+{
+    for (Pool *p = pools; p < pools + npools; ++p) {
+        if (p->binding != binding)
+            continue;
+
+        xcb_window_t window = p->nwindows ? p->windows[--p->nwindows] : XCB_NONE;
+        refill(p);
+        return window;
+    }
+
+    return XCB_NONE;
+}
+
+void
+pool_forget(xcb_window_t window)
+{
+    for (Pool *p = pools; p < pools + npools; ++p) {
+        for (int i = 0; i < p->nwindows; ++i) {
+            if (p->windows[i] != window)
+                continue;
+
+            p->windows[i] = p->windows[--p->nwindows];
+            refill(p);
+            return;
+        }
+    }
+}
+
+/*
+ * a pending process exited before its window was adopted: it crashed,
+ * or its window comes from another process. its slot is launched again
+ * unless the binding keeps failing.
+ */
+void
+pool_reaped(pid_t pid)
+{
+    for (Pool *p = pools; p < pools + npools; ++p) {
+        for (int i = 0; i < p->npending; ++i) {
+            if (p->pending[i] != pid)
+                continue;
+
+            p->pending[i] = p->pending[--p->npending];
+            npending--;
+            if (++p->lost > 2 * p->size) {
+                INFO("%s keeps exiting without a window, not launched ahead anymore.",
+                        p->binding->args[0]);
+                return;
+            }
+            refill(p);
+            return;
+        }
+    }
+}
+
+void
+pool_cleanup()
+{
+    for (Pool *p = pools; p < pools + npools; ++p) {
+        for (int i = 0; i < p->npending; ++i)
+            kill(p->pending[i], SIGTERM);
+        for (int i = 0; i < p->nwindows; ++i)
+            xcb_kill_client(g_xcb, p->windows[i]);
+    }
+
+    free(pools);
+    pools = NULL;
+    npools = npending = 0;
+}
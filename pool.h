@@ -0,0 +1,16 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <sys/types.h>
+#include <xcb/xcb.h>
+
+#include "settings.h"
+
+void pool_setup();
+int pool_adopt(xcb_window_t window);
+xcb_window_t pool_take(Binding *binding);
+void pool_forget(xcb_window_t window);
+void pool_reaped(pid_t pid);
+void pool_cleanup();
+
+#endif
@@ -0,0 +1,199 @@
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern.h"
+#include "log.h"
+#include "rules.h"
+#include "settings.h"
+
+/*
+ * the rules are compiled once: names without wildcard are interned and
+ * indexed by handle, the others are turned into regular expressions.
+ * when several rules match a window, the first one wins.
+ */
+
+typedef struct _Pattern {
+    regex_t     regex;
+    int         class;  /* matches the class, the instance otherwise */
+    int         rule;
+} Pattern;
+
+static int is_pattern(const char *name);
+static int compile(const char *glob, regex_t *regex);
+static void index_name(const char *name, int class, int rule);
+
+static int      *by_instance = NULL;    /* rule + 1 by handle, 0 if none */
+static int      *by_class = NULL;
+static int      handles = 0;
+static Pattern  *patterns = NULL;
+static int      npatterns = 0;
+
+int
+is_pattern(const char *name)
+{
+    return strpbrk(name, "*?[") != NULL;
+}
+
+/*
+ * translate a shell glob into an anchored extended regular expression,
+ * 0 on success. a bracket expression is copied as is, except for its
+ * leading ! that becomes ^ and a ] right after them that is kept.
+ */
+int
+compile(const char *glob, regex_t *regex)
+{
+    char *expression = malloc(2 * strlen(glob) + 3);
+    char *p = expression;
+
+    if (! expression)
+        FATAL("can't allocate the rule %s.", glob);
+
+    *p++ = '^';
+    for (const char *g = glob; *g; ++g) {
+        switch (*g) {
+            case '*': *p++ = '.'; *p++ = '*'; break;
+            case '?': *p++ = '.'; break;
+            case '[':
+                *p++ = *g++;
+                if (*g == '!') {
+                    *p++ = '^';
+                    g++;
+                }
+                if (*g == ']')
+                    *p++ = *g++;
+                while (*g && *g != ']')
+                    *p++ = *g++;
+                if (! *g) {
+                    ERROR("unterminated [ in the rule pattern %s, ignored.", glob);
+                    free(expression);
+                    return -1;
+                }
+                *p++ = *g;
+                break;
+            case '.': case '^': case '$': case '+': case '(': case ')':
+            case '{': case '}': case '|': case '\\':
+                *p++ = '\\';
+                /* fallthrough */
+            default:
+                *p++ = *g;
+                break;
+        }
+    }
+    *p++ = '$';
+    *p = '\0';
+
+    int failed = regcomp(regex, expression, REG_EXTENDED | REG_NOSUB);
+    if (failed)
+        ERROR("invalid rule pattern %s, ignored.", glob);
+
+    free(expression);
+    return failed ? -1 : 0;
+}
+
+void
+index_name(const char *name, int class, int rule)
+{
+    int handle = intern(name);
+
+    if (handle >= handles) {
+        int size = handles ? handles : 16;
+        while (size <= handle)
+            size *= 2;
+        by_instance = realloc(by_instance, size * sizeof(int));
+        by_class = realloc(by_class, size * sizeof(int));
+        if (! by_instance || ! by_class)
+            FATAL("can't allocate the rules index.");
+        memset(by_instance + handles, 0, (size - handles) * sizeof(int));
+        memset(by_class + handles, 0, (size - handles) * sizeof(int));
+        handles = size;
+    }
+
+    int *by_handle = class ? by_class : by_instance;
+    if (! by_handle[handle])
+        by_handle[handle] = rule + 1;
+}
+
+void
+rules_setup()
+{
+    int count = 0, exact = 0;
+
+    for (int i = 0; g_rules[i].class_name || g_rules[i].instance_name; ++i)
+        for (int j = 0; j < 2; ++j) {
+            const char *name = j ? g_rules[i].class_name : g_rules[i].instance_name;
+            if (name && is_pattern(name))
+                count++;
+        }
+
+    if (count) {
+        patterns = calloc(count, sizeof(Pattern));
+        if (! patterns)
+            FATAL("can't allocate the rules patterns.");
+    }
+
+    for (int i = 0; g_rules[i].class_name || g_rules[i].instance_name; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            const char *name = j ? g_rules[i].class_name : g_rules[i].instance_name;
+
+            if (! name)
+                continue;
+
+            if (is_pattern(name)) {
+                Pattern *p = &patterns[npatterns];
+                if (compile(name, &p->regex))
+                    continue;
+                p->class = j;
+                p->rule = i;
+                npatterns++;
+            } else {
+                index_name(name, j, i);
+                exact++;
+            }
+        }
+    }
+
+    INFO("rules: %d exact names, %d patterns.", exact, npatterns);
+}
+
+/* the first rule matching the interned instance or class, NULL if none */
+const Rule *
+rules_match(int instance, int class)
+{
+    int best = -1;
+
+    if (instance > 0 && instance < handles && by_instance[instance])
+        best = by_instance[instance] - 1;
+
+    if (class > 0 && class < handles && by_class[class] &&
+            (best < 0 || by_class[class] - 1 < best))
+        best = by_class[class] - 1;
+
+    /* patterns are in rule order, stop past the best exact match */
+    for (int i = 0; i < npatterns; ++i) {
+        Pattern *p = &patterns[i];
+        if (best >= 0 && p->rule >= best)
+            break;
+
+        const char *name = intern_string(p->class ? class : instance);
+        if (name && regexec(&p->regex, name, 0, NULL, 0) == 0) {
+            best = p->rule;
+            break;
+        }
+    }
+
+    return best < 0 ? NULL : &g_rules[best];
+}
+
+void
+rules_cleanup()
+{
+    for (int i = 0; i < npatterns; ++i)
+        regfree(&patterns[i].regex);
+    free(patterns);
+    free(by_instance);
+    free(by_class);
+    patterns = NULL;
+    by_instance = by_class = NULL;
+    npatterns = handles = 0;
+}
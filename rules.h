@@ -0,0 +1,10 @@
+#ifndef __RULES_H__
+#define __RULES_H__
+
+#include "settings.h"
+
+void rules_setup();
+const Rule *rules_match(int instance, int class);
+void rules_cleanup();
+
+#endif
@@ -21,15 +21,16 @@ unsigned int    g_bar_fgcolor               = 0xffffff;
 unsigned int    g_bar_selected_tag_fgcolor  = 0x000000;
 unsigned int    g_bar_selected_tag_bgcolor  = 0xffffff;
 double          g_split                     = .6f;
+unsigned int    g_focus_delay               = 0;    /* ms hovering, 0 to focus at once */
 char            g_font[]                    = "-*-terminus-medium-*-*-*-12-*-*-*-*-*-*-*";
 unsigned int    g_bar_height                = 24;
 
 Rule g_rules[] = {
-    /* class                instance            TAGSET      State */
-    { "Gnome-calculator",   "gnome-calculor",   -1,         MODE_FLOATING },
-    { "Xephyr",             "Xephyr",           -1,         MODE_FLOATING },
-    { "Xmessage",           "xmessage",         -1,         MODE_FLOATING },
-    { NULL, NULL, 0, 0 }
+    /* class                instance            TAGSET      State           Monitor */
+    { "Gnome-calculator",   "gnome-calculor",   -1,         MODE_FLOATING,  NULL },
+    { "Xephyr",             "Xephyr",           -1,         MODE_FLOATING,  NULL },
+    { "Xmessage",           "xmessage",         -1,         MODE_FLOATING,  NULL },
+    { NULL, NULL, 0, 0, NULL }
 };
 
 Shortcut g_shortcuts[] = {
@@ -54,6 +55,9 @@ Shortcut g_shortcuts[] = {
     {{K_MC,     XKB_KEY_Left},      CB_INT,     {focused_monitor_set_layout},           {LT_LEFT}},
     {{K_MC,     XKB_KEY_Down},      CB_INT,     {focused_monitor_set_layout},           {LT_BOTTOM}},
     {{K_MC,     XKB_KEY_Up},        CB_INT,     {focused_monitor_set_layout},           {LT_TOP}},
+    {{K_MC,     XKB_KEY_g},         CB_INT,     {focused_monitor_set_layout},           {LT_GRID}},
+    {{K_MC,     XKB_KEY_c},         CB_INT,     {focused_monitor_set_layout},           {LT_COLUMNS}},
+    {{K_MC,     XKB_KEY_s},         CB_INT,     {focused_monitor_set_layout},           {LT_SPIRAL}},
     {{K_M,      XKB_KEY_Tab},       CB_VOID,    {focused_monitor_rotate_clockwise},     {}},
     {{K_MS,     XKB_KEY_Tab},       CB_VOID,    {focused_monitor_rotate_counter_clockwise}, {}},
     {{K_M,      XKB_KEY_1},         CB_INT,     {focused_monitor_set_tag},              {1}},
@@ -119,20 +123,23 @@ Shortcut g_shortcuts[] = {
 "-sb", "#5e81ac", "-sf", "#2e3440"
 
 Binding g_bindings[] = {
-    /* modifier key                                 arguments      */
-    { {K_M,     XKB_KEY_Return },                   {"urxvt"} },
-    { {K_M,     XKB_KEY_d },                        {"dmenu_run", DMENU_OPTS} },
-    { {0,       XKB_KEY_XF86AudioRaiseVolume },     {"mixer", "vol", "+5%"} },
-    { {0,       XKB_KEY_XF86AudioLowerVolume },     {"mixer", "vol", "-5%"} },
+    /* modifier key                                 warm    arguments      */
+    { {K_M,     XKB_KEY_Return },                   0,      {"urxvt"} },
+    { {K_M,     XKB_KEY_d },                        0,      {"dmenu_run", DMENU_OPTS} },
+    { {0,       XKB_KEY_XF86AudioRaiseVolume },     0,      {"mixer", "vol", "+5%"} },
+    { {0,       XKB_KEY_XF86AudioLowerVolume },     0,      {"mixer", "vol", "-5%"} },
     /*
-    { {0,       XKB_KEY_XF86AudioMute },            {"pactl", "set-sink-mute", "0", "toggle"} },
-    { {0,       XKB_KEY_XF86AudioMicMute },         {"pactl", "set-source-mute", "1", "toggle"} },
-    { {K_M,     XKB_KEY_XF86AudioMute },            {"pavucontrol"} },
-    { {0,       XKB_KEY_XF86MonBrightnessUp },      {"xbacklight", "+", "5" } },
-    { {0,       XKB_KEY_XF86MonBrightnessDown },    {"xbacklight", "-", "5" } },
-    { {0,       XKB_KEY_XF86Display },              {"xrandr", "--output", "HDMI1", "--auto", "--right-of", "eDP1"} },
-    { {K_M,     XKB_KEY_XF86Display },              {"xrandr", "--output", "HDMI1", "--off" } },
+    { {0,       XKB_KEY_XF86AudioMute },            0,      {"pactl", "set-sink-mute", "0", "toggle"} },
+    { {0,       XKB_KEY_XF86AudioMicMute },         0,      {"pactl", "set-source-mute", "1", "toggle"} },
+    { {K_M,     XKB_KEY_XF86AudioMute },            0,      {"pavucontrol"} },
+    { {0,       XKB_KEY_XF86MonBrightnessUp },      0,      {"xbacklight", "+", "5" } },
+    { {0,       XKB_KEY_XF86MonBrightnessDown },    0,      {"xbacklight", "-", "5" } },
+    { {0,       XKB_KEY_XF86Display },              0,      {"xrandr", "--output", "HDMI1", "--auto", "--right-of", "eDP1"} },
+    { {K_M,     XKB_KEY_XF86Display },              0,      {"xrandr", "--output", "HDMI1", "--off" } },
     */
-    { { 0, 0 }, {NULL} }
+    { { 0, 0 }, 0, {NULL} }
 };
 
+/* launched when clicking the bar */
+Binding g_bar_binding = { {0, 0}, 0, {"uxterm"} };
+
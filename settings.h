@@ -43,14 +43,17 @@ typedef struct _Shortcut {
 
 typedef struct _Binding {
     KeySequence     sequence;
+    int             pool; /* number of instances kept warm */
     char            *args[16];
 } Binding;
 
+/* names may be shell globs, the first matching rule applies */
 typedef struct _Rule {
     char *class_name;
     char *instance_name;
     int tags;
-    int mode; /* see client mode */
+    int mode; /* see client mode, MODE_ANY keeps it */
+    char *monitor; /* NULL for the focused one */
 } Rule;
 
 /* static configuration */
@@ -65,10 +68,12 @@ extern unsigned int     g_bar_fgcolor;
 extern unsigned int     g_bar_selected_tag_fgcolor;
 extern unsigned int     g_bar_selected_tag_bgcolor;
 extern double           g_split;
+extern unsigned int     g_focus_delay;
 extern char             g_font[256];
 extern unsigned int     g_bar_height;
 extern Rule             g_rules[];
 extern Shortcut         g_shortcuts[]; 
 extern Binding          g_bindings[]; 
+extern Binding          g_bar_binding;
 
 #endif
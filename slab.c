@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "slab.h"
+
+#define ALIGNMENT 16
+#define ROUND(n) (((n) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+static void grow(Slab *slab);
+
+/* add a slab of objects to the free list, a slab spans as many pages as
+ * needed to hold at least eight objects */
+void
+grow(Slab *slab)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    size_t length, header, count;
+    char *p;
+
+    if (page <= 0)
+        page = 4096;
+
+    slab->size = ROUND(slab->size < sizeof(void*) ? sizeof(void*) : slab->size);
+    header = ROUND(sizeof(void*));
+    length = page;
+    while (length < header + 8 * slab->size)
+        length += page;
+
+    if (posix_memalign((void **)&p, page, length))
+        FATAL("can't allocate a slab.");
+
+    *(void **)p = slab->pages;
+    slab->pages = p;
+    slab->npages += length / page;
+
+    /* thread the objects so they are handed out in address order */
+    count = (length - header) / slab->size;
+    for (size_t i = count; i > 0; --i) {
+        char *object = p + header + (i - 1) * slab->size;
+        *(void **)object = slab->free;
+        slab->free = object;
+    }
+}
+
+/* return a zeroed object */
+void *
+slab_alloc(Slab *slab)
+{
+    if (! slab->free)
+        grow(slab);
+
+    void *object = slab->free;
+    slab->free = *(void **)object;
+    memset(object, 0, slab->size);
+
+    if (++slab->live > slab->peak)
+        slab->peak = slab->live;
+
+    return object;
+}
+
+void
+slab_free(Slab *slab, void *object)
+{
+    if (! object)
+        return;
+
+    *(void **)object = slab->free;
+    slab->free = object;
+    slab->live--;
+}
+
+void
+slab_destroy(Slab *slab)
+{
+    while (slab->pages) {
+        void *next = *(void **)slab->pages;
+        free(slab->pages);
+        slab->pages = next;
+    }
+    slab->free = NULL;
+    slab->npages = 0;
+    slab->live = 0;
+}
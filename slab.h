@@ -0,0 +1,26 @@
+#ifndef __SLAB_H__
+#define __SLAB_H__
+
+#include <stddef.h>
+
+/*
+ * fixed size objects carved out of page sized slabs.
+ * freed objects go back to a free list and are never returned to the
+ * heap before slab_destroy().
+ */
+typedef struct _Slab {
+    size_t  size;       /* object size, rounded to the alignment */
+    void    *free;      /* free objects, linked through their first word */
+    void    *pages;     /* slabs, linked through their first word */
+    long    npages;
+    long    live;
+    long    peak;
+} Slab;
+
+#define SLAB(type) { .size = sizeof(type) }
+
+void *slab_alloc(Slab *slab);
+void slab_free(Slab *slab, void *object);
+void slab_destroy(Slab *slab);
+
+#endif
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <xcb/xcb.h>
+
+#include "log.h"
+#include "stack.h"
+#include "x11.h"
+
+/*
+ * each monitor keeps its clients in the order they are stacked on the
+ * server, from the bottom to the top. the wanted order is the clients
+ * sorted by layer then by the time they were last raised. only the
+ * clients that are not part of the longest run already in order are
+ * moved, each relatively to the client below it. the fullscreen clients
+ * and the docks are always raised on top of everything, the bar and the
+ * other monitors included, since they are not part of this order.
+ */
+
+static StackLayer layer(Client *c);
+static int before(Client *a, Client *b);
+static void reserve(int count);
+
+static unsigned int rank = 0;       /* raises so far */
+static Client       **wanted = NULL;
+static int          *tails = NULL;  /* longest ordered run, see stack_apply */
+static int          *links = NULL;
+static char         *kept = NULL;
+static int          scratch_size = 0;
+static StackStats   stats;
+
+StackLayer
+layer(Client *c)
+{
+    if ((c->state & STATE_DOCK) == STATE_DOCK)
+        return LAYER_DOCK;
+    if (c->mode == MODE_FULLSCREEN)
+        return LAYER_FULLSCREEN;
+    if (c->transient)
+        return LAYER_TRANSIENT;
+    if (c->mode == MODE_FLOATING)
+        return LAYER_FLOATING;
+    return LAYER_TILED;
+}
+
+int
+before(Client *a, Client *b)
+{
+    StackLayer la = layer(a), lb = layer(b);
+    return la != lb ? la < lb : a->info->stack_rank < b->info->stack_rank;
+}
+
+void
+reserve(int count)
+{
+    if (count <= scratch_size)
+        return;
+
+    scratch_size = count * 2;
+    wanted = realloc(wanted, scratch_size * sizeof(Client *));
+    tails = realloc(tails, scratch_size * sizeof(int));
+    links = realloc(links, scratch_size * sizeof(int));
+    kept = realloc(kept, scratch_size);
+    if (! wanted || ! tails || ! links || ! kept)
+        FATAL("can't allocate the stacking order.");
+}
+
+/* the client goes on top of its layer, where it is unknown yet */
+void
+stack_attach(Monitor *monitor, Client *client)
+{
+    if (monitor->nstack == monitor->stack_size) {
+        monitor->stack_size = monitor->stack_size ? monitor->stack_size * 2 : 16;
+        monitor->stack = realloc(monitor->stack, monitor->stack_size * sizeof(Client *));
+        if (! monitor->stack)
+            FATAL("can't allocate the stacking order.");
+    }
+
+    client->info->stack_rank = ++rank;
+    client->info->stack_index = -1;
+    monitor->stack[monitor->nstack++] = client;
+}
+
+void
+stack_detach(Monitor *monitor, Client *client)
+{
+    for (int i = 0; i < monitor->nstack; ++i) {
+        if (monitor->stack[i] == client) {
+            memmove(&monitor->stack[i], &monitor->stack[i + 1],
+                    (monitor->nstack - i - 1) * sizeof(Client *));
+            monitor->nstack--;
+            break;
+        }
+    }
+}
+
+void
+stack_raise(Monitor *monitor, Client *client)
+{
+    client->info->stack_rank = ++rank;
+    stack_apply(monitor);
+}
+
+void
+stack_apply(Monitor *monitor)
+{
+    int n = monitor->nstack;
+
+    if (! n)
+        return;
+
+    stats.restacks++;
+    reserve(n);
+
+    /* the current positions, the clients just attached have none */
+    for (int i = 0; i < n; ++i) {
+        if (monitor->stack[i]->info->stack_index != -1)
+            monitor->stack[i]->info->stack_index = i;
+        wanted[i] = monitor->stack[i];
+    }
+
+    /* the order is nearly right most of the time */
+    for (int i = 1; i < n; ++i) {
+        Client *c = wanted[i];
+        int j = i - 1;
+        while (j >= 0 && before(c, wanted[j])) {
+            wanted[j + 1] = wanted[j];
+            j--;
+        }
+        wanted[j + 1] = c;
+    }
+
+    /* the clients below the fullscreen layer are ordered among themselves */
+    int top = 0;
+    while (top < n && layer(wanted[top]) < LAYER_FULLSCREEN)
+        top++;
+
+    /* longest run of wanted clients whose current positions increase */
+    int length = 0;
+    for (int i = 0; i < top; ++i) {
+        kept[i] = 0;
+        int p = wanted[i]->info->stack_index;
+        if (p < 0)
+            continue;
+
+        int lo = 0, hi = length;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (wanted[tails[mid]]->info->stack_index < p)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        links[i] = lo ? tails[lo - 1] : -1;
+        tails[lo] = i;
+        if (lo == length)
+            length++;
+    }
+    for (int i = length ? tails[length - 1] : -1; i >= 0; i = links[i])
+        kept[i] = 1;
+
+    /* move the others right above the client below them, the bottom
+     * one goes below the lowest client kept */
+    int lowest = 0;
+    while (lowest < top && ! kept[lowest])
+        lowest++;
+
+    for (int i = 0; i < top; ++i) {
+        if (kept[i])
+            continue;
+
+        xcb_void_cookie_t cookie;
+        if (i > 0)
+            cookie = xcb_configure_window(
+                    g_xcb,
+                    wanted[i]->window,
+                    XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
+                    (const unsigned int []) {
+                        wanted[i - 1]->window,
+                        XCB_STACK_MODE_ABOVE });
+        else if (lowest < top)
+            cookie = xcb_configure_window(
+                    g_xcb,
+                    wanted[i]->window,
+                    XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
+                    (const unsigned int []) {
+                        wanted[lowest]->window,
+                        XCB_STACK_MODE_BELOW });
+        else
+            cookie = xcb_configure_window(
+                    g_xcb,
+                    wanted[i]->window,
+                    XCB_CONFIG_WINDOW_STACK_MODE,
+                    (const unsigned int []) { XCB_STACK_MODE_ABOVE });
+        g_layout_sequence = cookie.sequence;
+        stats.requests++;
+    }
+
+    for (int i = top; i < n; ++i) {
+        g_layout_sequence = xcb_configure_window(
+                g_xcb,
+                wanted[i]->window,
+                XCB_CONFIG_WINDOW_STACK_MODE,
+                (const unsigned int []) { XCB_STACK_MODE_ABOVE }).sequence;
+        stats.requests++;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        monitor->stack[i] = wanted[i];
+        wanted[i]->info->stack_index = i;
+    }
+}
+
+void
+stack_release(Monitor *monitor)
+{
+    free(monitor->stack);
+    monitor->stack = NULL;
+    monitor->nstack = monitor->stack_size = 0;
+}
+
+const StackStats *
+stack_stats()
+{
+    return &stats;
+}
@@ -0,0 +1,28 @@
+#ifndef __STACK_H__
+#define __STACK_H__
+
+#include "client.h"
+#include "monitor.h"
+
+/* layers, from the bottom to the top */
+typedef enum _StackLayer {
+    LAYER_TILED,
+    LAYER_FLOATING,
+    LAYER_TRANSIENT,
+    LAYER_FULLSCREEN,
+    LAYER_DOCK
+} StackLayer;
+
+typedef struct _StackStats {
+    long    restacks;
+    long    requests;
+} StackStats;
+
+void stack_attach(Monitor *monitor, Client *client);
+void stack_detach(Monitor *monitor, Client *client);
+void stack_raise(Monitor *monitor, Client *client);
+void stack_apply(Monitor *monitor);
+void stack_release(Monitor *monitor);
+const StackStats *stack_stats();
+
+#endif
@@ -0,0 +1,225 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xcb/xcb.h>
+#include <xcb/sync.h>
+
+#include "log.h"
+#include "sync.h"
+#include "x11.h"
+
+/*
+ * _NET_WM_SYNC_REQUEST: before a client is resized it is sent a value,
+ * it sets its counter to that value once it has drawn itself at the new
+ * size. an alarm on the counter tells us so. until then its next
+ * geometries are not sent, only the latest one is once the client is
+ * done or the timeout expires.
+ */
+
+#define SYNC_TIMEOUT 200
+
+static void done(Client *c);
+static void on_timeout(void *data);
+
+static Client       **syncing = NULL;   /* the clients with an alarm */
+static int          nsyncing = 0;
+static int          syncing_size = 0;
+static SyncStats    stats;
+
+void
+done(Client *c)
+{
+    ClientInfo *i = c->info;
+
+    timer_disarm(&i->sync_timeout);
+    i->sync_waiting = 0;
+    if (i->sync_deferred) {
+        i->sync_deferred = 0;
+        client_show(c);
+    }
+}
+
+void
+on_timeout(void *data)
+{
+    stats.timeouts++;
+    done(data);
+}
+
+/* the replies are those of WM_PROTOCOLS and _NET_WM_SYNC_REQUEST_COUNTER,
+ * asked for with the other properties of the client */
+void
+sync_attach(Client *c, xcb_get_property_reply_t *protocols, xcb_get_property_reply_t *counter)
+{
+    ClientInfo *i = c->info;
+
+    i->sync_counter = XCB_NONE;
+    i->sync_alarm = XCB_NONE;
+    i->sync_value = 0;
+    i->sync_waiting = 0;
+    i->sync_deferred = 0;
+    i->sync_timeout = (Timer) { .callback = on_timeout, .data = c };
+
+    if (! g_sync_base_event)
+        return;
+
+    int supported = 0;
+    if (protocols) {
+        xcb_atom_t *atoms = xcb_get_property_value(protocols);
+        int count = xcb_get_property_value_length(protocols) / sizeof(xcb_atom_t);
+        for (int j = 0; j < count && ! supported; ++j)
+            supported = atoms[j] == g_ewmh._NET_WM_SYNC_REQUEST;
+    }
+    if (supported && counter && xcb_get_property_value_length(counter) >= 4)
+        i->sync_counter = *(xcb_sync_counter_t *)xcb_get_property_value(counter);
+
+    if (i->sync_counter == XCB_NONE)
+        return;
+
+    /* go on from where the client is, only the clients taking sync
+     * requests pay for this round trip */
+    xcb_sync_query_counter_reply_t *value = xcb_sync_query_counter_reply(
+            g_xcb,
+            xcb_sync_query_counter(g_xcb, i->sync_counter),
+            NULL);
+    if (! value) {
+        i->sync_counter = XCB_NONE;
+        return;
+    }
+    i->sync_value = ((uint64_t)(uint32_t)value->counter_value.hi << 32) |
+        value->counter_value.lo;
+    free(value);
+
+    /* the alarm fires once each time it is set, see sync_request */
+    uint64_t next = i->sync_value + 1;
+    i->sync_alarm = xcb_generate_id(g_xcb);
+    xcb_sync_create_alarm(
+            g_xcb,
+            i->sync_alarm,
+            XCB_SYNC_CA_COUNTER |
+            XCB_SYNC_CA_VALUE_TYPE |
+            XCB_SYNC_CA_VALUE |
+            XCB_SYNC_CA_TEST_TYPE |
+            XCB_SYNC_CA_DELTA |
+            XCB_SYNC_CA_EVENTS,
+            (const uint32_t []) {
+                i->sync_counter,
+                XCB_SYNC_VALUETYPE_ABSOLUTE,
+                next >> 32, next & 0xffffffff,
+                XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+                0, 0,
+                1 });
+
+    if (nsyncing == syncing_size) {
+        syncing_size = syncing_size ? syncing_size * 2 : 8;
+        syncing = realloc(syncing, syncing_size * sizeof(Client *));
+        if (! syncing)
+            FATAL("can't allocate the sync clients.");
+    }
+    syncing[nsyncing++] = c;
+}
+
+void
+sync_detach(Client *c)
+{
+    timer_disarm(&c->info->sync_timeout);
+    if (c->info->sync_alarm == XCB_NONE)
+        return;
+
+    xcb_sync_destroy_alarm(g_xcb, c->info->sync_alarm);
+    c->info->sync_alarm = XCB_NONE;
+    c->info->sync_counter = XCB_NONE;
+
+    for (int i = 0; i < nsyncing; ++i) {
+        if (syncing[i] == c) {
+            syncing[i] = syncing[--nsyncing];
+            break;
+        }
+    }
+}
+
+/*
+ * to be called before the geometry of the client is sent. returns 1 if
+ * the client is still drawing its previous size, the geometry is then
+ * sent once it is done.
+ */
+int
+sync_request(Client *c, int resized)
+{
+    ClientInfo *i = c->info;
+
+    if (i->sync_counter == XCB_NONE)
+        return 0;
+
+    if (i->sync_waiting) {
+        if (i->sync_deferred)
+            stats.dropped++;
+        i->sync_deferred = 1;
+        return 1;
+    }
+
+    if (! resized)
+        return 0;
+
+    i->sync_value++;
+    xcb_client_message_event_t e;
+    memset(&e, 0, sizeof(e));
+    e.response_type = XCB_CLIENT_MESSAGE;
+    e.format = 32;
+    e.window = c->window;
+    e.type = g_ewmh.WM_PROTOCOLS;
+    e.data.data32[0] = g_ewmh._NET_WM_SYNC_REQUEST;
+    e.data.data32[1] = XCB_CURRENT_TIME;
+    e.data.data32[2] = i->sync_value & 0xffffffff;
+    e.data.data32[3] = i->sync_value >> 32;
+    xcb_send_event(g_xcb, 0, c->window, XCB_EVENT_MASK_NO_EVENT, (const char *)&e);
+
+    xcb_sync_change_alarm(
+            g_xcb,
+            i->sync_alarm,
+            XCB_SYNC_CA_VALUE,
+            (const uint32_t []) { i->sync_value >> 32, i->sync_value & 0xffffffff });
+
+    i->sync_waiting = 1;
+    timer_arm(&i->sync_timeout, SYNC_TIMEOUT);
+    stats.requests++;
+
+    return 0;
+}
+
+void
+sync_on_alarm(xcb_generic_event_t *e)
+{
+    xcb_sync_alarm_notify_event_t *a = (xcb_sync_alarm_notify_event_t *)e;
+
+    for (int i = 0; i < nsyncing; ++i) {
+        Client *c = syncing[i];
+        if (c->info->sync_alarm != a->alarm)
+            continue;
+
+        /* a late answer to a request that timed out */
+        uint64_t value = ((uint64_t)(uint32_t)a->counter_value.hi << 32) |
+            a->counter_value.lo;
+        if (! c->info->sync_waiting || value < c->info->sync_value)
+            return;
+
+        stats.acks++;
+        done(c);
+        return;
+    }
+}
+
+void
+sync_cleanup()
+{
+    free(syncing);
+    syncing = NULL;
+    nsyncing = syncing_size = 0;
+}
+
+const SyncStats *
+sync_stats()
+{
+    return &stats;
+}
@@ -0,0 +1,22 @@
+#ifndef __SYNC_H__
+#define __SYNC_H__
+
+#include <xcb/xcb.h>
+
+#include "client.h"
+
+typedef struct _SyncStats {
+    long    requests;   /* sizes sent with a sync request */
+    long    acks;
+    long    timeouts;
+    long    dropped;    /* sizes replaced before they were sent */
+} SyncStats;
+
+void sync_attach(Client *c, xcb_get_property_reply_t *protocols, xcb_get_property_reply_t *counter);
+void sync_detach(Client *c);
+int sync_request(Client *c, int resized);
+void sync_on_alarm(xcb_generic_event_t *e);
+void sync_cleanup();
+const SyncStats *sync_stats();
+
+#endif
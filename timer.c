@@ -0,0 +1,91 @@
+#include <time.h>
+
+#include "timer.h"
+
+static Timer *armed = NULL;
+
+void
+timer_now(struct timespec *t)
+{
+    clock_gettime(CLOCK_MONOTONIC, t);
+}
+
+/* microseconds elapsed since the given time */
+long
+timer_elapsed(const struct timespec *since)
+{
+    struct timespec now;
+    timer_now(&now);
+    return (now.tv_sec - since->tv_sec) * 1000000L +
+        (now.tv_nsec - since->tv_nsec) / 1000L;
+}
+
+/* (re)arm the timer to fire in ms milliseconds, arming an armed timer
+ * pushes its deadline back */
+void
+timer_arm(Timer *t, long ms)
+{
+    timer_now(&t->deadline);
+    t->deadline.tv_sec += ms / 1000;
+    t->deadline.tv_nsec += (ms % 1000) * 1000000L;
+    if (t->deadline.tv_nsec >= 1000000000L) {
+        t->deadline.tv_sec++;
+        t->deadline.tv_nsec -= 1000000000L;
+    }
+
+    if (! t->armed) {
+        t->armed = 1;
+        t->next = armed;
+        armed = t;
+    }
+}
+
+void
+timer_disarm(Timer *t)
+{
+    if (! t->armed)
+        return;
+
+    for (Timer **p = &armed; *p; p = &(*p)->next) {
+        if (*p == t) {
+            *p = t->next;
+            break;
+        }
+    }
+    t->armed = 0;
+    t->next = NULL;
+}
+
+/* milliseconds until the next deadline, -1 when no timer is armed */
+int
+timer_timeout()
+{
+    long timeout = -1;
+
+    for (Timer *t = armed; t; t = t->next) {
+        long us = -timer_elapsed(&t->deadline);
+        long ms = us > 0 ? (us + 999) / 1000 : 0;
+        if (timeout < 0 || ms < timeout)
+            timeout = ms;
+    }
+
+    return (int)timeout;
+}
+
+/* fire the expired timers, a callback may arm timers again */
+void
+timer_run()
+{
+    Timer *t = armed;
+
+    while (t) {
+        if (timer_elapsed(&t->deadline) < 0) {
+            t = t->next;
+            continue;
+        }
+
+        timer_disarm(t);
+        t->callback(t->data);
+        t = armed;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <time.h>
+
+/* a one-shot timer run from the main loop */
+typedef struct _Timer {
+    struct timespec     deadline;
+    int                 armed;
+    void                (*callback)(void *data);
+    void                *data;
+    struct _Timer       *next;
+} Timer;
+
+void timer_now(struct timespec *t);
+long timer_elapsed(const struct timespec *since);
+void timer_arm(Timer *t, long ms);
+void timer_disarm(Timer *t);
+int timer_timeout();
+void timer_run();
+
+#endif
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <string.h>
 
 #include <xcb/xcb.h>
@@ -6,6 +7,7 @@
 #include <xcb/xcb_ewmh.h>
 #include <xcb/xkb.h>
 #include <xcb/randr.h>
+#include <xcb/sync.h>
 #include <xkbcommon/xkbcommon.h>
 #include <xkbcommon/xkbcommon-compose.h>
 #include <xkbcommon/xkbcommon-x11.h>
@@ -22,6 +24,10 @@ xcb_colormap_t          g_colormap;
 xcb_ewmh_connection_t   g_ewmh;
 xcb_atom_t              g_atoms[MWM_ATOM_COUNT];
 struct xkb_state       *g_xkb_state;
+uint8_t                 g_xkb_base_event;
+uint8_t                 g_randr_base_event;
+uint8_t                 g_sync_base_event = 0;
+unsigned int            g_layout_sequence = 0;
 
 /* static variables */
 static const char *atom_names[MWM_ATOM_COUNT] = {
@@ -30,6 +36,7 @@ static const char *atom_names[MWM_ATOM_COUNT] = {
     "MWM_MONITOR_TAGSET",
     "MWM_FOCUSED",
     "MWM_FOCUSED_TAGSET",
+    "_NET_WM_BYPASS_COMPOSITOR",
 };
 
 void
@@ -41,6 +48,7 @@ x11_setup()
 
     xcb_prefetch_extension_data(g_xcb, &xcb_xkb_id);
     xcb_prefetch_extension_data(g_xcb, &xcb_randr_id);
+    xcb_prefetch_extension_data(g_xcb, &xcb_sync_id);
 
     const xcb_query_extension_reply_t *ext_reply;
     ext_reply = xcb_get_extension_data(g_xcb, &xcb_xkb_id);
@@ -49,6 +57,31 @@ x11_setup()
     ext_reply = xcb_get_extension_data(g_xcb, &xcb_randr_id);
     if (!ext_reply->present)
         FATAL("no randr extension on this server.");
+    g_randr_base_event = ext_reply->first_event;
+
+    /* the clients are resized without waiting for them otherwise */
+    ext_reply = xcb_get_extension_data(g_xcb, &xcb_sync_id);
+    if (ext_reply && ext_reply->present) {
+        xcb_sync_initialize_reply_t *sync_reply = xcb_sync_initialize_reply(
+                g_xcb,
+                xcb_sync_initialize(g_xcb, 3, 1),
+                NULL);
+        if (sync_reply) {
+            g_sync_base_event = ext_reply->first_event;
+            free(sync_reply);
+        }
+    }
+
+    if (! xkb_x11_setup_xkb_extension(
+            g_xcb,
+            XKB_X11_MIN_MAJOR_XKB_VERSION,
+            XKB_X11_MIN_MINOR_XKB_VERSION,
+            0,
+            NULL,
+            NULL,
+            &g_xkb_base_event,
+            NULL))
+        FATAL("can't setup the xkb extension.");
 
     xcb_intern_atom_cookie_t *init_atoms_cookie = xcb_ewmh_init_atoms(
             g_xcb,
@@ -3,6 +3,7 @@
 
 #include <xcb/xcb.h>
 #include <xcb/xcb_ewmh.h>
+#include <xcb/sync.h>
 #include <xcb/xkb.h>
 #include <xkbcommon/xkbcommon.h>
 #include <xkbcommon/xkbcommon-compose.h>
@@ -15,6 +16,7 @@ enum {
     MWM_MONITOR_TAGSET,
     MWM_FOCUSED,
     MWM_FOCUSED_TAGSET,
+    NET_WM_BYPASS_COMPOSITOR,
     MWM_ATOM_COUNT
 };
 
@@ -27,6 +29,10 @@ extern xcb_colormap_t           g_colormap;
 extern xcb_ewmh_connection_t    g_ewmh;
 extern xcb_atom_t               g_atoms[MWM_ATOM_COUNT];
 extern struct xkb_state         *g_xkb_state;
+extern uint8_t                  g_xkb_base_event;
+extern uint8_t                  g_randr_base_event;
+extern uint8_t                  g_sync_base_event;  /* 0 without the extension */
+extern unsigned int             g_layout_sequence;  /* last window moved */
 
 void x11_setup();
 void x11_cleanup();